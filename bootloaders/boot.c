@@ -23,7 +23,8 @@
 
 /*
  * UART Bootloader for tinyAVR 0- and 1-series, and megaAVR 0-series
- * Each byte received is echoed to confirm reception.
+ * The image is sent in CRC checked frames, each acknowledged once it is
+ * written, see the protocol description below and upload.py.
  *
  * For the code to be placed in the constructors section it is necessary
  * to disable standard startup files in Toolchain->AVR/GNU Linker->General.
@@ -33,21 +34,113 @@
  * USART0 RxD PA5
  * LED0       PD6
  * SW1        PC1 (external pull-up)
+ *
+ * The application is started right away after a reset unless a boot request
+ * is present: the boot flag in USERROW31 set by the firmware, SW1 held down,
+ * or, if BOOT_ON_EXTERNAL_RESET is set, an external reset. The status LED
+ * only blinks once the bootloader has been entered, and only if BOOT_BLINK
+ * is set. If no frame arrives for BOOT_TIMEOUT ms, the bootloader resets
+ * into the application.
  */
 #define F_CPU_RESET (16E6/6)
+#define F_CPU_BOOT  (16E6)
 
 #include <avr/io.h>
+#include <util/crc16.h>
 #include <assert.h>
 #include <stdbool.h>
 
-/* Baud rate configuration */
-#define BOOT_BAUD (115200)
+/* Boot request sources, set to 0 to disable
+ * An external reset only counts where the fuses make the pin a RESET pin,
+ * so it is off by default */
+#ifndef BOOT_ON_EXTERNAL_RESET
+#define BOOT_ON_EXTERNAL_RESET (0)
+#endif
+#ifndef BOOT_ON_SW1
+#define BOOT_ON_SW1 (1)
+#endif
+
+/* 3 very fast blinks (to match optiboot behaviour) when entering the bootloader */
+#ifndef BOOT_BLINK
+#define BOOT_BLINK (1)
+#endif
+
+/* Baud rate configuration
+ * The clock prescaler is turned off in the bootloader, allowing up to 1 Mbaud
+ */
+#ifndef BOOT_BAUD
+#define BOOT_BAUD (500000)
+#endif
+
+#define BAUD_REG_VAL (F_CPU_BOOT * 64) / (BOOT_BAUD * 16)
 
-#define BAUD_REG_VAL (F_CPU_RESET * 64) / (BOOT_BAUD * 16)
+/* Time without a frame after which the application is started, in ms */
+#ifndef BOOT_TIMEOUT
+#define BOOT_TIMEOUT (1000)
+#endif
+#if BOOT_TIMEOUT < 20 || BOOT_TIMEOUT / 20 > 255
+#error BOOT_TIMEOUT must be from 20 to 5100 ms
+#endif
+
+/* Protocol
+ * Each frame sent by the host is
+ *   command (1), address (2), length (1), data (length), CRC (2)
+ * with the address and the CRC little endian. The CRC is the CRC-16/CCITT
+ * of _crc_ccitt_update(), starting at 0xFFFF, over all bytes before it.
+ * The bootloader answers each frame with ACK once it is done with it, or
+ * with NAK if the frame was corrupted or refused, in which case the host
+ * may send it again. A pause of about 20 ms within a frame ends it, so a
+ * lost byte does not throw the framing off.
+ *
+ * CMD_WRITE   write the page at address (a flash address, page aligned and
+ *             above the boot section), length is the page size
+ * CMD_CRC     report the CRCs of the pages from address on, length is 1 and
+ *             the data byte the number of pages; the ACK is followed by the
+ *             CRC of each page, computed as for frames, 2 bytes little endian
+ * CMD_START   start unpacking a compressed image to address, page aligned
+ *             and above the boot section, length is 0
+ * CMD_UNPACK  the compressed data from offset address in the compressed
+ *             image on; only whole tokens, see below
+ * CMD_COMMIT  done; after the ACK the application is started. When an image
+ *             was unpacked, length is 2 and the data the CRC of the unpacked
+ *             image, which is checked against the Flash first
+ *
+ * Pages written with the data they already hold are not erased and written
+ * again, and with CMD_CRC the host can leave out unchanged pages altogether.
+ *
+ * A compressed image is a series of tokens, each either
+ *   0x00 - 0x7F  a run of token + 1 literal bytes, which follow
+ *   0x80 - 0xFF  a copy of (token & 0x7F) + 3 bytes from the unpacked data,
+ *                the distance back to them follows in 2 bytes little endian
+ * The unpacked data is collected a page at a time. Copies from earlier
+ * pages read back what was written to Flash, so no window is kept in RAM.
+ *
+ * The first page of the application, right after the boot section, is
+ * erased before any other page is written or an image is unpacked, so that
+ * an interrupted upload leaves no start of an application behind. The host
+ * must write that page last, changed or not; an unpacked image holds it back
+ * until CMD_COMMIT, and erases it again if the image does not check out.
+ */
+#define CMD_WRITE    ('W')
+#define CMD_CRC      ('R')
+#define CMD_START    ('Z')
+#define CMD_UNPACK   ('U')
+#define CMD_COMMIT   ('C')
+
+#define ACK          (0x06)
+#define NAK          (0x15)
+
+#define FRAME_HEADER (4)
+#define FRAME_CRC    (2)
+
+#define TOKEN_COPY   (0x80)
+#define COPY_MIN     (3)
 
 /* Memory configuration
- * BOOTEND_FUSE * 256 must be above Bootloader Program Memory Usage,
- * this is 194 bytes at optimization level -O3, so BOOTEND_FUSE = 0x01
+ * BOOTEND_FUSE * 256 must be above Bootloader Program Memory Usage, so
+ * BOOTEND_FUSE = 0x02. build.sh refuses a build whose .text does not fit.
+ * BOOTEND_FUSE, BOOT_SIZE in upload.py and the .text start and sizes of
+ * the boards in boards.txt go together
  */
 #define BOOTEND_FUSE               (0x02)
 #define BOOT_SIZE                  (BOOTEND_FUSE * 0x100)
@@ -70,11 +163,36 @@ FUSES = {
 /* Define application pointer type */
 typedef void (*const app_t)(void);
 
+/* Frame being received, kept out of the stack of the naked boot function */
+static uint8_t frame[FRAME_HEADER + MAPPED_PROGMEM_PAGE_SIZE + FRAME_CRC];
+
+/* Unpacking: the page being unpacked, where the image starts (0 if none),
+ * where the next unpacked byte goes, and the compressed offset expected next */
+static uint8_t unpacked[MAPPED_PROGMEM_PAGE_SIZE];
+static uint16_t unpack_start;
+static uint16_t unpack_address;
+static uint16_t unpack_offset;
+
+/* The first page of the application when unpacked, written at the commit */
+static uint8_t app_start[MAPPED_PROGMEM_PAGE_SIZE];
+static bool app_start_held;
+
 /* Interface function prototypes */
 static inline bool is_bootloader_requested(void);
 static inline void init_uart(void);
-static inline uint8_t uart_receive(void);
+static inline int16_t uart_receive(void);
 static inline void uart_send(uint8_t byte);
+static inline bool wait_frame(void);
+static inline bool receive_frame(void);
+static inline uint8_t handle_frame(void);
+static inline void send_crcs(void);
+static inline uint8_t unpack_frame(uint16_t offset, uint8_t length);
+static inline uint8_t unpack_commit(uint8_t length);
+static bool unpack_page(uint16_t address);
+static bool is_app_page(uint16_t address);
+static bool write_page(uint16_t address, const uint8_t *data);
+static void erase_app_start(void);
+static uint16_t flash_crc(uint16_t address, uint16_t length);
 static inline void init_status_led(void);
 static inline void toggle_status_led(void);
 static inline void wait_50_ms(void);
@@ -89,14 +207,8 @@ __attribute__((naked)) __attribute__((section(".ctors"))) void boot(void)
   /* Initialize system for AVR GCC support, expects r1 = 0 */
   asm volatile("clr r1");
 
-  /* 3 very fast blinks (to match optiboot behaviour) */
-  init_status_led();
-  for (uint8_t i = 0; i < 6; i++) {
-    wait_50_ms();
-    toggle_status_led();
-  }
-
-  /* Check if entering application or continuing to bootloader */
+  /* Check if entering application or continuing to bootloader,
+   * before doing anything else so that the application starts at once */
   if(!is_bootloader_requested()) {
     /* Enable Boot Section Lock */
     NVMCTRL.CTRLB = NVMCTRL_BOOTLOCK_bm;
@@ -106,32 +218,33 @@ __attribute__((naked)) __attribute__((section(".ctors"))) void boot(void)
     app();
   }
 
+  init_status_led();
+#if BOOT_BLINK
+  for (uint8_t i = 0; i < 6; i++) {
+    wait_50_ms();
+    toggle_status_led();
+  }
+#endif
+
+  /* Run at the full 16 MHz for the higher baud rate */
+  _PROTECTED_WRITE(CLKCTRL.MCLKCTRLB, 0);
+
   /* Initialize communication interface */
   init_uart();
+  unpack_start = 0;
 
-  /*
-   * Start programming at start for application section
-   * Subtract MAPPED_PROGMEM_START in condition to handle overflow on large flash sizes
-   */
-  uint8_t *app_ptr = (uint8_t *)MAPPED_APPLICATION_START;
-  while(app_ptr - MAPPED_PROGMEM_START <= (uint8_t *)PROGMEM_END) {
-    /* Receive and echo data before loading to memory */
-    uint8_t rx_data = uart_receive();
-    if (app_ptr == (uint8_t *)MAPPED_APPLICATION_START && rx_data == 0) {
-      // skip first character if 0x00
-      continue;
-    }
-    uart_send(rx_data);
-
-    /* Incremental load to page buffer before writing to Flash */
-    *app_ptr = rx_data;
-    app_ptr++;
-    if(!((uint16_t)app_ptr % MAPPED_PROGMEM_PAGE_SIZE)) {
-      /* Page boundary reached, Commit page to Flash */
-      _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
-      while(NVMCTRL.STATUS & NVMCTRL_FBUSY_bm);
-
-      toggle_status_led();
+  /* Serve frames until the host commits the image, or goes quiet. The
+   * reset below starts the application either way, as it is no boot request */
+  while (wait_frame()) {
+    uint8_t reply = receive_frame() ? handle_frame() : NAK;
+    uart_send(reply);
+    if (reply == ACK && frame[0] == CMD_CRC) {
+      send_crcs();
+    }
+    if (reply == ACK && frame[0] == CMD_COMMIT) {
+      /* Let the last ACK go out */
+      while(!(USART0.STATUS & USART_TXCIF_bm));
+      break;
     }
   }
 
@@ -139,6 +252,285 @@ __attribute__((naked)) __attribute__((section(".ctors"))) void boot(void)
   _PROTECTED_WRITE(RSTCTRL.SWRR, RSTCTRL_SWRE_bm);
 }
 
+/*
+ * Protocol functions
+ */
+static inline bool wait_frame(void)
+{
+  /* Poll for the start of a frame in rounds of about 20 ms, as in
+   * uart_receive(), giving up after BOOT_TIMEOUT */
+  for (uint8_t rounds = BOOT_TIMEOUT / 20; rounds; rounds--) {
+    uint16_t timeout = 0;
+    do {
+      if (USART0.STATUS & USART_RXCIF_bm) {
+        return true;
+      }
+    } while (--timeout);
+  }
+  return false;
+}
+
+static inline bool receive_frame(void)
+{
+  uint16_t crc = 0xFFFF;
+  uint16_t size = FRAME_HEADER;
+
+  /* Called once wait_frame() has seen the first byte */
+  int16_t rx = uart_receive();
+
+  for (uint16_t i = 0; ; ) {
+    if (i < sizeof(frame)) {
+      frame[i] = rx;
+    }
+    crc = _crc_ccitt_update(crc, rx);
+    if (++i == FRAME_HEADER) {
+      /* Too long a frame is read until it ends, and refused */
+      size = (frame[3] <= MAPPED_PROGMEM_PAGE_SIZE) ? FRAME_HEADER + frame[3] + FRAME_CRC : 0xFFFF;
+    }
+    if (i == size) {
+      /* The CRC of the data followed by its CRC is 0 */
+      return crc == 0;
+    }
+    if ((rx = uart_receive()) < 0) {
+      return false;
+    }
+  }
+}
+
+static inline uint8_t handle_frame(void)
+{
+  uint16_t address = frame[1] | (frame[2] << 8);
+  uint8_t length = frame[3];
+
+  if (frame[0] == CMD_WRITE) {
+    /* Refuse before the first page of the application is erased */
+    if (length != MAPPED_PROGMEM_PAGE_SIZE || !is_app_page(address)) {
+      return NAK;
+    }
+    if (address != BOOT_SIZE) {
+      erase_app_start();
+    }
+    return write_page(address, frame + FRAME_HEADER) ? ACK : NAK;
+  }
+
+  if (frame[0] == CMD_CRC) {
+    uint8_t count = frame[FRAME_HEADER];
+    if (length != 1 || count == 0 || (address % MAPPED_PROGMEM_PAGE_SIZE) ||
+        address > PROGMEM_END || count > (PROGMEM_SIZE - address) / MAPPED_PROGMEM_PAGE_SIZE) {
+      return NAK;
+    }
+    return ACK;
+  }
+
+  if (frame[0] == CMD_START) {
+    if (length != 0 || !is_app_page(address)) {
+      return NAK;
+    }
+    erase_app_start();
+    unpack_start = unpack_address = address;
+    unpack_offset = 0;
+    app_start_held = false;
+    return ACK;
+  }
+
+  if (frame[0] == CMD_UNPACK) {
+    return unpack_frame(address, length);
+  }
+
+  if (frame[0] == CMD_COMMIT) {
+    return unpack_commit(length);
+  }
+  return NAK;
+}
+
+static inline uint8_t unpack_frame(uint16_t offset, uint8_t length)
+{
+  if (!unpack_start || offset > unpack_offset) {
+    return NAK;
+  }
+  if (offset < unpack_offset) {
+    /* Sent again after the ACK was lost, already unpacked */
+    return ACK;
+  }
+
+  /* Check all tokens before unpacking any, so that a bad frame is refused
+   * with nothing written: each must end within the frame, copy from the
+   * unpacked image and leave it within Flash */
+  const uint8_t *end = frame + FRAME_HEADER + length;
+  uint16_t at = unpack_address;
+  for (const uint8_t *in = frame + FRAME_HEADER; in < end; ) {
+    uint8_t token = *in++;
+    if (token & TOKEN_COPY) {
+      uint16_t distance = in[0] | (in[1] << 8);
+      if (end - in < 2 || distance == 0 || distance > at - unpack_start) {
+        return NAK;
+      }
+      in += 2;
+      at += (token & ~TOKEN_COPY) + COPY_MIN;
+    } else {
+      if (end - in <= token) {
+        return NAK;
+      }
+      in += token + 1;
+      at += token + 1;
+    }
+    if (at > PROGMEM_SIZE) {
+      return NAK;
+    }
+  }
+
+  const uint8_t *in = frame + FRAME_HEADER;
+  while (in < end) {
+    uint8_t token = *in++;
+    uint8_t count = token + 1;
+    uint16_t distance = 0;
+    if (token & TOKEN_COPY) {
+      count = (token & ~TOKEN_COPY) + COPY_MIN;
+      distance = in[0] | (in[1] << 8);
+      in += 2;
+    }
+
+    while (count--) {
+      uint8_t data;
+      if (!distance) {
+        data = *in++;
+      } else {
+        uint16_t from = unpack_address - distance;
+        if (from >= (unpack_address & ~(MAPPED_PROGMEM_PAGE_SIZE - 1))) {
+          data = unpacked[from % MAPPED_PROGMEM_PAGE_SIZE];
+        } else if (app_start_held && (uint16_t)(from - BOOT_SIZE) < MAPPED_PROGMEM_PAGE_SIZE) {
+          data = app_start[from % MAPPED_PROGMEM_PAGE_SIZE];
+        } else {
+          data = *(const uint8_t *)(MAPPED_PROGMEM_START + from);
+        }
+      }
+      unpacked[unpack_address % MAPPED_PROGMEM_PAGE_SIZE] = data;
+
+      if (!(++unpack_address % MAPPED_PROGMEM_PAGE_SIZE)) {
+        unpack_page(unpack_address - MAPPED_PROGMEM_PAGE_SIZE);
+      }
+    }
+  }
+
+  unpack_offset += length;
+  return ACK;
+}
+
+static inline uint8_t unpack_commit(uint8_t length)
+{
+  if (!unpack_start) {
+    return (length == 0) ? ACK : NAK;
+  }
+  if (length != 2) {
+    return NAK;
+  }
+
+  /* Write the last page, if partly unpacked, then the first page of the
+   * application, and check the image in Flash */
+  uint8_t used = unpack_address % MAPPED_PROGMEM_PAGE_SIZE;
+  if (used) {
+    for (uint8_t i = used; i < MAPPED_PROGMEM_PAGE_SIZE; i++) {
+      unpacked[i] = 0xFF;
+    }
+    unpack_page(unpack_address - used);
+  }
+  if (app_start_held) {
+    write_page(BOOT_SIZE, app_start);
+  }
+  uint16_t crc = frame[FRAME_HEADER] | (frame[FRAME_HEADER + 1] << 8);
+  if (flash_crc(unpack_start, unpack_address - unpack_start) != crc) {
+    erase_app_start();
+    return NAK;
+  }
+  return ACK;
+}
+
+/* Write an unpacked page, except for the first page of the application,
+ * which is held back until the commit */
+static bool unpack_page(uint16_t address)
+{
+  if (address != BOOT_SIZE) {
+    return write_page(address, unpacked);
+  }
+  for (uint8_t i = 0; i < MAPPED_PROGMEM_PAGE_SIZE; i++) {
+    app_start[i] = unpacked[i];
+  }
+  app_start_held = true;
+  return true;
+}
+
+/* Whether address is the start of a page of the application section */
+static bool is_app_page(uint16_t address)
+{
+  return !(address % MAPPED_PROGMEM_PAGE_SIZE) && address >= BOOT_SIZE && address <= PROGMEM_END;
+}
+
+/* Commit the page to Flash, unless it already holds the data. The page
+ * buffer can only be loaded once before a write clears it, so it is only
+ * loaded once the page is known to differ */
+static bool write_page(uint16_t address, const uint8_t *data)
+{
+  if (!is_app_page(address)) {
+    return false;
+  }
+
+  uint8_t *page = (uint8_t *)(MAPPED_PROGMEM_START + address);
+  uint8_t i = 0;
+  while (i < MAPPED_PROGMEM_PAGE_SIZE && page[i] == data[i]) {
+    i++;
+  }
+  if (i < MAPPED_PROGMEM_PAGE_SIZE) {
+    for (i = 0; i < MAPPED_PROGMEM_PAGE_SIZE; i++) {
+      page[i] = data[i];
+    }
+    _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
+    while(NVMCTRL.STATUS & NVMCTRL_FBUSY_bm);
+  }
+
+  toggle_status_led();
+  return true;
+}
+
+/* Erase the first page of the application, unless it is erased already.
+ * A byte written to the page buffer selects the page to erase */
+static void erase_app_start(void)
+{
+  uint8_t *page = (uint8_t *)MAPPED_APPLICATION_START;
+  for (uint8_t i = 0; i < MAPPED_PROGMEM_PAGE_SIZE; i++) {
+    if (page[i] != 0xFF) {
+      page[0] = 0xFF;
+      _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASE_gc);
+      while(NVMCTRL.STATUS & NVMCTRL_FBUSY_bm);
+      return;
+    }
+  }
+}
+
+static uint16_t flash_crc(uint16_t address, uint16_t length)
+{
+  const uint8_t *ptr = (const uint8_t *)(MAPPED_PROGMEM_START + address);
+  uint16_t crc = 0xFFFF;
+
+  while (length--) {
+    crc = _crc_ccitt_update(crc, *ptr++);
+  }
+  return crc;
+}
+
+static inline void send_crcs(void)
+{
+  /* Checked by handle_frame() */
+  uint16_t address = frame[1] | (frame[2] << 8);
+  uint8_t count = frame[FRAME_HEADER];
+
+  while (count--) {
+    uint16_t crc = flash_crc(address, MAPPED_PROGMEM_PAGE_SIZE);
+    uart_send(crc & 0xFF);
+    uart_send(crc >> 8);
+    address += MAPPED_PROGMEM_PAGE_SIZE;
+  }
+}
+
 /*
  * Boot access request function
  */
@@ -153,6 +545,23 @@ static inline bool is_bootloader_requested(void)
 
     return true;
   }
+
+#if BOOT_ON_EXTERNAL_RESET
+  /* Check for reset button. Power-on, brown-out, watchdog and software
+   * resets go straight to the application. The flag is cleared so that
+   * the software reset after programming does not enter again */
+  if (RSTCTRL.RSTFR & RSTCTRL_EXTRF_bm) {
+    RSTCTRL.RSTFR = RSTCTRL_EXTRF_bm;
+    return true;
+  }
+#endif
+
+#if BOOT_ON_SW1
+  /* Check for SW1 (PC1) held down */
+  if (!(VPORTC.IN & PIN1_bm)) {
+    return true;
+  }
+#endif
   return false;
 }
 
@@ -167,7 +576,7 @@ static inline void init_uart(void)
   /* From datasheet:
    * Baud rate compensated with factory stored frequency error
    * Asynchronous communication without Auto-baud (Sync Field)
-   * 20MHz Clock, 3V
+   * 16MHz Clock, 5V
    */
   int32_t baud_reg_val  = BAUD_REG_VAL;  // ideal BAUD register value
   int8_t sigrow_val = SIGROW.OSC16ERR5V;  // read signed error
@@ -182,16 +591,22 @@ static inline void init_uart(void)
   VPORTA.DIR |= PIN4_bm;
 }
 
-static inline uint8_t uart_receive(void)
+static inline int16_t uart_receive(void)
 {
-  /* Poll for data received */
-  while(!(USART0.STATUS & USART_RXCIF_bm));
+  /* Poll for data received, giving up after about 20 ms */
+  uint16_t timeout = 0;
+  while(!(USART0.STATUS & USART_RXCIF_bm)) {
+    if (!--timeout) {
+      return -1;
+    }
+  }
   return USART0.RXDATAL;
 }
 
 static inline void uart_send(uint8_t byte)
 {
   /* Data will be sent when TXDATA is written */
+  while(!(USART0.STATUS & USART_DREIF_bm));
   USART0.TXDATAL = byte;
 }
 
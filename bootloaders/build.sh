@@ -8,6 +8,21 @@ echo Compiling
 ${AVR_GCC_PATH}/avr-gcc -c -g -Os -w  -fpermissive -fno-exceptions -ffunction-sections -fdata-sections -fno-threadsafe-statics -Wno-error=narrowing -Wl,--gc-sections -w -mmcu=atmega4809 -DF_CPU=16000000L boot.c -o boot.o
 ${AVR_GCC_PATH}/avr-gcc  -g -Os -w  -fpermissive -fno-exceptions -ffunction-sections -fdata-sections -fno-threadsafe-statics -Wno-error=narrowing -nostartfiles  -Wl,--gc-sections  -w -mmcu=atmega4809 -DF_CPU=16000000L boot.o -o boot.elf
 
+echo Checking size
+BOOT_SIZE=$(( $(sed -n 's/^#define BOOTEND_FUSE *(\(0x[0-9A-Fa-f]*\)).*/\1/p' boot.c) * 256 ))
+TEXT_SIZE=$(${AVR_GCC_PATH}/avr-size -A boot.elf | awk '$1 == ".text" { print $2 }')
+echo .text is ${TEXT_SIZE} of ${BOOT_SIZE} bytes
+if [ -z "${TEXT_SIZE}" ] || [ ${TEXT_SIZE} -gt ${BOOT_SIZE} ]; then
+echo .text does not fit in the boot section, raise BOOTEND_FUSE
+exit 1
+fi
+
+# boot() is naked, so it must not set up a stack frame in the Y registers
+if ${AVR_GCC_PATH}/avr-objdump -d boot.elf | sed -n '/<boot>:/,/^$/p' | grep -Eq 'in\s+r2[89], 0x3[de]'; then
+echo boot uses the Y registers, move the code that needs them out of line
+exit 1
+fi
+
 echo Extracting bin
 ${AVR_GCC_PATH}/avr-objcopy -O ihex -R .fuses boot.elf boot.hex
 #${AVR_GCC_PATH}avr-objcopy -O binary -j .fuses --set-section-flags=.fuses=alloc,load --no-change-warnings --change-section-lma .fuses=0 boot.elf boot.fuses
@@ -0,0 +1,241 @@
+#!/usr/bin/env python3
+#
+# Uploader for the UART bootloader in boot.c
+#
+# Sends an Intel HEX image page by page in CRC checked frames, waiting for
+# the ACK of each page and sending it again on NAK or timeout. Pages the
+# bootloader reports as unchanged are left out, unless --full is given.
+# With --compress the image is sent compressed instead, for slow links.
+#
+# Usage: upload.py [-b BAUD] [--full | --compress] PORT FILE.hex
+#
+# Requires pyserial.
+
+import argparse
+import sys
+
+import serial
+
+CMD_WRITE = ord('W')
+CMD_CRC = ord('R')
+CMD_START = ord('Z')
+CMD_UNPACK = ord('U')
+CMD_COMMIT = ord('C')
+
+ACK = 0x06
+NAK = 0x15
+
+PAGE_SIZE = 128
+BOOT_SIZE = 0x200
+RETRIES = 5
+CRC_PAGES = 32  # Pages per CMD_CRC request
+
+TOKEN_COPY = 0x80
+COPY_MIN = 3
+COPY_MAX = 0x7F + COPY_MIN
+LITERAL_MAX = PAGE_SIZE - 1  # A token with its literals fits in a frame
+
+
+def crc_ccitt_update(crc, data):
+    # Same as _crc_ccitt_update() of avr-libc
+    data ^= crc & 0xFF
+    data = (data ^ (data << 4)) & 0xFF
+    return (((data << 8) | (crc >> 8)) ^ (data >> 4) ^ (data << 3)) & 0xFFFF
+
+
+def crc_of(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc = crc_ccitt_update(crc, byte)
+    return crc
+
+
+def make_frame(command, address, data=b''):
+    frame = bytes([command, address & 0xFF, address >> 8, len(data)]) + bytes(data)
+    crc = crc_of(frame)
+    return frame + bytes([crc & 0xFF, crc >> 8])
+
+
+def read_hex(path):
+    image = {}
+    base = 0
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith(':'):
+                continue
+            record = bytes.fromhex(line[1:])
+            if sum(record) & 0xFF:
+                sys.exit('%s: checksum error in %s' % (path, line))
+            length, address, kind = record[0], (record[1] << 8) | record[2], record[3]
+            data = record[4:4 + length]
+            if kind == 0:
+                for i, byte in enumerate(data):
+                    image[base + address + i] = byte
+            elif kind == 1:
+                break
+            elif kind == 2:
+                base = ((data[0] << 8) | data[1]) << 4
+            elif kind == 4:
+                base = ((data[0] << 8) | data[1]) << 16
+    return image
+
+
+def pages_of(image):
+    pages = {}
+    for address, byte in image.items():
+        start = address - address % PAGE_SIZE
+        page = pages.setdefault(start, bytearray(b'\xff' * PAGE_SIZE))
+        page[address - start] = byte
+    return pages
+
+
+def transfer(port, frame, answer=0):
+    # Returns the answer bytes following the ACK, or None
+    for _ in range(RETRIES):
+        port.reset_input_buffer()
+        port.write(frame)
+        reply = port.read(1 + answer)
+        if len(reply) == 1 + answer and reply[0] == ACK:
+            return reply[1:]
+    return None
+
+
+def commit(port, frame):
+    # Sent only once: after the ACK the bootloader starts the application,
+    # which would get any resent frame. Returns True for ACK, False for NAK
+    # and None if the answer was lost
+    port.reset_input_buffer()
+    port.write(frame)
+    reply = port.read(1)
+    if not reply:
+        return None
+    return reply[0] == ACK
+
+
+def check_commit(result, refused):
+    if result is None:
+        sys.exit('No answer to commit, the upload is unconfirmed')
+    if not result:
+        sys.exit(refused)
+
+
+def flash_crcs(port, starts):
+    # CRC of each page in flash, for the pages from the first to the last of starts
+    crcs = {}
+    address, end = min(starts), max(starts) + PAGE_SIZE
+    while address < end:
+        count = min(CRC_PAGES, (end - address) // PAGE_SIZE)
+        answer = transfer(port, make_frame(CMD_CRC, address, [count]), 2 * count)
+        if answer is None:
+            sys.exit('No CRCs for page 0x%04x' % address)
+        for i in range(count):
+            crcs[address + i * PAGE_SIZE] = answer[2 * i] | (answer[2 * i + 1] << 8)
+        address += count * PAGE_SIZE
+    return crcs
+
+
+def compress(data):
+    # Greedy LZ in the token format of boot.c, returns the list of tokens
+    tokens = []
+    literals = bytearray()
+    recent = {}
+    i = 0
+    while i < len(data):
+        best_len, best_from = 0, 0
+        for start in recent.get(bytes(data[i:i + COPY_MIN]), ()):
+            if i - start > 0xFFFF:
+                continue
+            n = 0
+            while n < COPY_MAX and i + n < len(data) and data[start + n] == data[i + n]:
+                n += 1
+            if n > best_len:
+                best_len, best_from = n, start
+        if best_len >= COPY_MIN:
+            if literals:
+                tokens.append(bytes([len(literals) - 1]) + literals)
+                literals = bytearray()
+            distance = i - best_from
+            tokens.append(bytes([TOKEN_COPY | (best_len - COPY_MIN), distance & 0xFF, distance >> 8]))
+            step = best_len
+        else:
+            literals.append(data[i])
+            if len(literals) == LITERAL_MAX:
+                tokens.append(bytes([len(literals) - 1]) + literals)
+                literals = bytearray()
+            step = 1
+        for j in range(i, i + step):
+            chain = recent.setdefault(bytes(data[j:j + COPY_MIN]), [])
+            chain.insert(0, j)
+            del chain[16:]
+        i += step
+    if literals:
+        tokens.append(bytes([len(literals) - 1]) + literals)
+    return tokens
+
+
+def upload_compressed(port, pages):
+    # The image runs from the first page to the last byte, gaps filled with 0xff
+    start = min(pages)
+    image = bytearray(b''.join(pages.get(a, b'\xff' * PAGE_SIZE) for a in range(start, max(pages) + PAGE_SIZE, PAGE_SIZE)))
+    image = image.rstrip(b'\xff') or image[:1]
+
+    frames = [bytearray()]
+    for token in compress(image):
+        if len(frames[-1]) + len(token) > PAGE_SIZE:
+            frames.append(bytearray())
+        frames[-1] += token
+    print('%d bytes compressed to %d' % (len(image), sum(len(f) for f in frames)))
+
+    if transfer(port, make_frame(CMD_START, start)) is None:
+        sys.exit('No ACK for start')
+    offset = 0
+    for n, data in enumerate(frames):
+        if transfer(port, make_frame(CMD_UNPACK, offset, data)) is None:
+            sys.exit('No ACK for compressed data at %d' % offset)
+        offset += len(data)
+        print('\r%d/%d frames' % (n + 1, len(frames)), end='', flush=True)
+    print()
+    crc = crc_of(image)
+    check_commit(commit(port, make_frame(CMD_COMMIT, 0, [crc & 0xFF, crc >> 8])), 'Unpacked image does not check out')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Upload through the UART bootloader')
+    parser.add_argument('-b', '--baud', type=int, default=500000)
+    mode = parser.add_mutually_exclusive_group()
+    mode.add_argument('--full', action='store_true', help='write all pages, changed or not')
+    mode.add_argument('--compress', action='store_true', help='send the image compressed')
+    parser.add_argument('port')
+    parser.add_argument('file')
+    args = parser.parse_args()
+
+    pages = pages_of(read_hex(args.file))
+    if min(pages) != BOOT_SIZE:
+        sys.exit('%s: image does not start right after the boot section' % args.file)
+
+    # The bootloader erases the first page as soon as another page is
+    # written, so that an interrupted upload does not leave the start of an
+    # application behind; it goes last, and must be sent changed or not
+    order = sorted(pages)
+    order = order[1:] + order[:1]
+
+    with serial.Serial(args.port, args.baud, timeout=0.5) as port:
+        if args.compress:
+            upload_compressed(port, pages)
+            return
+        if not args.full:
+            crcs = flash_crcs(port, order)
+            changed = [start for start in order if crcs[start] != crc_of(pages[start])]
+            order = changed and [start for start in changed if start != BOOT_SIZE] + [BOOT_SIZE]
+            print('%d of %d pages changed' % (len(changed), len(pages)))
+        for n, start in enumerate(order):
+            if transfer(port, make_frame(CMD_WRITE, start, pages[start])) is None:
+                sys.exit('No ACK for page 0x%04x' % start)
+            print('\r%d/%d pages' % (n + 1, len(order)), end='', flush=True)
+        print()
+        check_commit(commit(port, make_frame(CMD_COMMIT, 0)), 'Commit refused')
+
+
+if __name__ == '__main__':
+    main()
@@ -115,6 +115,30 @@ extern const uint8_t PROGMEM digital_pin_to_timer[];
 void setup_timers();
 bool isDoubleBondedActive(uint8_t pin);
 
+/* Signature row and user row access, see nvm.c */
+#define SIGROW_SERIAL_SIZE 10
+#define USER_ROW_SIZE (sizeof(USERROW_t))
+
+uint32_t sigrowDeviceId();
+void sigrowSerialNumber(uint8_t *serial);
+int8_t sigrowOscError(uint8_t mhz, uint8_t vcc);
+uint8_t sigrowTempSenseGain();
+int8_t sigrowTempSenseOffset();
+
+uint8_t userRowRead(uint8_t offset);
+void userRowReadBlock(uint8_t offset, void *dst, uint8_t len);
+bool userRowWrite(uint8_t offset, uint8_t value);
+bool userRowWriteBlock(uint8_t offset, const void *src, uint8_t len);
+
+/* Writing the APPDATA section of the flash, see nvm.c. Addresses are byte
+	addresses in the flash */
+uint16_t flashAppDataStart();
+uint16_t flashAppDataSize();
+void flashRead(uint16_t addr, void *dst, uint16_t len);
+bool flashPageErase(uint16_t addr);
+bool flashPageWrite(uint16_t addr, const void *src, uint8_t len);
+bool flashWrite(uint16_t addr, const void *src, uint16_t len);
+
 #define digitalPinToPort(pin) ( (pin < NUM_TOTAL_PINS) ? pgm_read_byte(digital_pin_to_port + pin) : NOT_A_PIN )
 #define digitalPinToBitPosition(pin) ( (pin < NUM_TOTAL_PINS) ? pgm_read_byte(digital_pin_to_bit_position + pin) : NOT_A_PIN )
 #define analogPinToBitPosition(pin) ( (pin < NUM_ANALOG_INPUTS) ? pgm_read_byte(digital_pin_to_bit_position + pin + ANALOG_INPUT_OFFSET) : NOT_A_PIN )
@@ -0,0 +1,172 @@
+/*
+  Copyright (c) 2019 Arduino.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+#include <stdint.h>
+
+/*
+  Remapping of ATMEGA328 port bits to ATMEGA4809 port bits, shared by the
+  UNO_compat and NANO_Compat register emulation.
+
+  A map holds one byte for each of the 8 bits of a 328 port, giving the
+  4809 port and bit it is wired to, or COMPAT_NC. compat_port<map, port>
+  derives from a map, at compile time, what it takes to move bits between
+  the 328 register and one 4809 port: mask() gathers the bits of the 4809
+  port that a 328 value covers, and gather() does the reverse for reads.
+  The map and the port being template arguments, everything but the value
+  is a constant, so that for any value mask() and gather() are a shift and
+  mask where the bits keep their order, and a bit test and OR per wired bit
+  otherwise; for constant values they fold to a constant. Assigning a 328
+  register thus costs a single SET and CLR store per 4809 port, and reading
+  it one load per 4809 port.
+*/
+
+enum { COMPAT_PA, COMPAT_PB, COMPAT_PC, COMPAT_PD, COMPAT_PE, COMPAT_PF };
+
+#define COMPAT_BIT(port, bit) ((uint8_t)((port) << 3 | (bit)))
+#define COMPAT_NC             0xFF
+
+constexpr uint64_t compat_map(uint8_t const b0, uint8_t const b1, uint8_t const b2, uint8_t const b3,
+                              uint8_t const b4, uint8_t const b5, uint8_t const b6, uint8_t const b7) {
+  return (uint64_t)b0       | (uint64_t)b1 <<  8 | (uint64_t)b2 << 16 | (uint64_t)b3 << 24 |
+         (uint64_t)b4 << 32 | (uint64_t)b5 << 40 | (uint64_t)b6 << 48 | (uint64_t)b7 << 56;
+}
+
+#define COMPAT_ENTRY(map, i)            ((uint8_t)((map) >> (8 * (i))))
+#define COMPAT_ON_PORT(map, port, i)    ((COMPAT_ENTRY(map, i) >> 3) == (port))
+#define COMPAT_DISTANCE(map, i)         ((int8_t)((COMPAT_ENTRY(map, i) & 7) - (i)))
+#define COMPAT_SPAN_BIT(map, port, i)   (COMPAT_ON_PORT(map, port, i) ? 1 << (i) : 0)
+#define COMPAT_FIRST(map, port, i, next) (COMPAT_ON_PORT(map, port, i) ? COMPAT_DISTANCE(map, i) : (next))
+#define COMPAT_SAME(map, port, i, shift) (!COMPAT_ON_PORT(map, port, i) || COMPAT_DISTANCE(map, i) == (shift))
+#define COMPAT_MASK_BIT(val, i)         (((val) & (1 << (i))) ? bit<i>::to : 0)
+#define COMPAT_GATHER_BIT(in, i)        (((in) & bit<i>::to) ? 1 << (i) : 0)
+
+template<uint64_t MAP, uint8_t PORT>
+struct compat_port {
+  /* 328 bits wired to this port */
+  static constexpr uint8_t span = COMPAT_SPAN_BIT(MAP, PORT, 0) | COMPAT_SPAN_BIT(MAP, PORT, 1) |
+                                  COMPAT_SPAN_BIT(MAP, PORT, 2) | COMPAT_SPAN_BIT(MAP, PORT, 3) |
+                                  COMPAT_SPAN_BIT(MAP, PORT, 4) | COMPAT_SPAN_BIT(MAP, PORT, 5) |
+                                  COMPAT_SPAN_BIT(MAP, PORT, 6) | COMPAT_SPAN_BIT(MAP, PORT, 7);
+
+  /* Distance from a 328 bit to the 4809 bit it is wired to, for the first bit on this port */
+  static constexpr int8_t shift = COMPAT_FIRST(MAP, PORT, 0, COMPAT_FIRST(MAP, PORT, 1,
+                                  COMPAT_FIRST(MAP, PORT, 2, COMPAT_FIRST(MAP, PORT, 3,
+                                  COMPAT_FIRST(MAP, PORT, 4, COMPAT_FIRST(MAP, PORT, 5,
+                                  COMPAT_FIRST(MAP, PORT, 6, COMPAT_FIRST(MAP, PORT, 7, 0))))))));
+
+  /* True if all 328 bits on this port are wired at the same distance, so that
+     the bits can be moved with a single shift and mask */
+  static constexpr bool shifted = COMPAT_SAME(MAP, PORT, 0, shift) && COMPAT_SAME(MAP, PORT, 1, shift) &&
+                                  COMPAT_SAME(MAP, PORT, 2, shift) && COMPAT_SAME(MAP, PORT, 3, shift) &&
+                                  COMPAT_SAME(MAP, PORT, 4, shift) && COMPAT_SAME(MAP, PORT, 5, shift) &&
+                                  COMPAT_SAME(MAP, PORT, 6, shift) && COMPAT_SAME(MAP, PORT, 7, shift);
+
+  /* The shift split into its two directions, one of them 0 */
+  static constexpr uint8_t up   = (shift > 0) ? shift : 0;
+  static constexpr uint8_t down = (shift < 0) ? -shift : 0;
+
+  /* 4809 bit of this port wired to 328 bit I, 0 if it is wired elsewhere */
+  template<uint8_t I> struct bit {
+    static constexpr uint8_t to = COMPAT_ON_PORT(MAP, PORT, I) ? 1 << (COMPAT_ENTRY(MAP, I) & 7) : 0;
+  };
+
+  /* Bits of this port wired to the bits set in the 328 value 'val' */
+  __attribute__((always_inline)) static constexpr uint8_t mask(uint8_t const val) {
+    return shifted ?
+           (uint8_t)(((val & span) << up) >> down) :
+           COMPAT_MASK_BIT(val, 0) | COMPAT_MASK_BIT(val, 1) | COMPAT_MASK_BIT(val, 2) | COMPAT_MASK_BIT(val, 3) |
+           COMPAT_MASK_BIT(val, 4) | COMPAT_MASK_BIT(val, 5) | COMPAT_MASK_BIT(val, 6) | COMPAT_MASK_BIT(val, 7);
+  }
+
+  /* The reverse of mask(): bits of the 328 value wired to the bits set in
+     'in', read from this port. OR the result over all ports of the map */
+  __attribute__((always_inline)) static constexpr uint8_t gather(uint8_t const in) {
+    return shifted ?
+           (uint8_t)(((in >> up) << down) & span) :
+           COMPAT_GATHER_BIT(in, 0) | COMPAT_GATHER_BIT(in, 1) | COMPAT_GATHER_BIT(in, 2) | COMPAT_GATHER_BIT(in, 3) |
+           COMPAT_GATHER_BIT(in, 4) | COMPAT_GATHER_BIT(in, 5) | COMPAT_GATHER_BIT(in, 6) | COMPAT_GATHER_BIT(in, 7);
+  }
+};
+
+template<uint64_t MAP, uint8_t PORT> constexpr uint8_t compat_port<MAP, PORT>::span;
+template<uint64_t MAP, uint8_t PORT> constexpr int8_t  compat_port<MAP, PORT>::shift;
+template<uint64_t MAP, uint8_t PORT> constexpr bool    compat_port<MAP, PORT>::shifted;
+template<uint64_t MAP, uint8_t PORT> constexpr uint8_t compat_port<MAP, PORT>::up;
+template<uint64_t MAP, uint8_t PORT> constexpr uint8_t compat_port<MAP, PORT>::down;
+template<uint64_t MAP, uint8_t PORT> template<uint8_t I> constexpr uint8_t compat_port<MAP, PORT>::bit<I>::to;
+
+/* Each 328 bit is driven from one 4809 bit, so 'value' sets exactly the wired
+   bits it has set and clears exactly the wired bits it has clear */
+#define COMPAT_ASSIGN(port_reg, map, port, set_reg, clr_reg, value) \
+  do { (port_reg)->set_reg = compat_port<map, port>::mask(value); (port_reg)->clr_reg = compat_port<map, port>::mask(~(value)); } while(0)
+#define COMPAT_SET(port_reg, map, port, set_reg, value) \
+  do { (port_reg)->set_reg = compat_port<map, port>::mask(value); } while(0)
+#define COMPAT_CLEAR(port_reg, map, port, clr_reg, value) \
+  do { (port_reg)->clr_reg = compat_port<map, port>::mask(~(value)); } while(0)
+#define COMPAT_READ(port_reg, map, port, reg) \
+  compat_port<map, port>::gather((port_reg)->reg)
+
+/*
+  ADCSRA, mapped onto ADC0. Prescaler values select the same division
+  (ADPS 0 and 1 both divide by 2), reading back ADIF and writing it as one
+  clears RESRDY, and ADSC starts a conversion and reads as one until it is
+  done, as on the 328. The result registers and ADMUX are not emulated.
+*/
+#ifndef HOST_BUILD
+
+#include <avr/io.h>
+
+#ifndef ADEN
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE  3
+#define ADIF  4
+#define ADATE 5
+#define ADSC  6
+#define ADEN  7
+#endif
+
+class ADCSRAClass {
+  public:
+    operator uint8_t () const {
+      uint8_t const presc = ADC0.CTRLC & ADC_PRESC_gm;
+      return ((ADC0.CTRLA & ADC_ENABLE_bm)     ? (1 << ADEN)  : 0) |
+             ((ADC0.COMMAND & ADC_STCONV_bm)   ? (1 << ADSC)  : 0) |
+             ((ADC0.CTRLA & ADC_FREERUN_bm)    ? (1 << ADATE) : 0) |
+             ((ADC0.INTFLAGS & ADC_RESRDY_bm)  ? (1 << ADIF)  : 0) |
+             ((ADC0.INTCTRL & ADC_RESRDY_bm)   ? (1 << ADIE)  : 0) |
+             ((presc < ADC_PRESC_DIV256_gc) ? (presc >> ADC_PRESC_gp) + 1 : 7);
+    }
+    ADCSRAClass & operator  = (uint8_t const value) {
+      uint8_t const adps = value & 7;
+      ADC0.CTRLC = (ADC0.CTRLC & ~ADC_PRESC_gm) | ((adps ? adps - 1 : 0) << ADC_PRESC_gp);
+      ADC0.INTCTRL = (ADC0.INTCTRL & ~ADC_RESRDY_bm) | ((value & (1 << ADIE)) ? ADC_RESRDY_bm : 0);
+      if (value & (1 << ADIF)) ADC0.INTFLAGS = ADC_RESRDY_bm;
+      ADC0.CTRLA = (ADC0.CTRLA & ~(ADC_ENABLE_bm | ADC_FREERUN_bm)) |
+                   ((value & (1 << ADEN))  ? ADC_ENABLE_bm  : 0) |
+                   ((value & (1 << ADATE)) ? ADC_FREERUN_bm : 0);
+      if (value & (1 << ADSC)) ADC0.COMMAND = ADC_STCONV_bm;
+      return *this;
+    }
+    ADCSRAClass & operator &= (uint8_t const value) { return *this = (uint8_t)*this & value; }
+    ADCSRAClass & operator |= (uint8_t const value) { return *this = (uint8_t)*this | value; }
+};
+
+#endif /* #ifndef HOST_BUILD */
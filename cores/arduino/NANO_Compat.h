@@ -18,6 +18,7 @@
 
 #pragma once
 #include <Arduino.h>
+#include "Compat_remap.h"
 
 #ifdef AVR_NANO_4809_328MODE
 
@@ -47,26 +48,96 @@
   A7           ADC7        PD5
 */
 
+/* 328 bit to 4809 bit, see the table above */
+static constexpr uint64_t NANO_PORTB_MAP = compat_map(COMPAT_BIT(COMPAT_PE, 3), COMPAT_BIT(COMPAT_PB, 0), COMPAT_BIT(COMPAT_PB, 1), COMPAT_BIT(COMPAT_PE, 0),
+                                                      COMPAT_BIT(COMPAT_PE, 1), COMPAT_BIT(COMPAT_PE, 2), COMPAT_NC,                COMPAT_NC);
+static constexpr uint64_t NANO_PORTC_MAP = compat_map(COMPAT_BIT(COMPAT_PD, 3), COMPAT_BIT(COMPAT_PD, 2), COMPAT_BIT(COMPAT_PD, 1), COMPAT_BIT(COMPAT_PD, 0),
+                                                      COMPAT_BIT(COMPAT_PA, 2), COMPAT_BIT(COMPAT_PA, 3), COMPAT_BIT(COMPAT_PD, 4), COMPAT_BIT(COMPAT_PD, 5));
+static constexpr uint64_t NANO_PORTD_MAP = compat_map(COMPAT_BIT(COMPAT_PC, 4), COMPAT_BIT(COMPAT_PC, 5), COMPAT_BIT(COMPAT_PA, 0), COMPAT_BIT(COMPAT_PF, 5),
+                                                      COMPAT_BIT(COMPAT_PC, 6), COMPAT_BIT(COMPAT_PB, 2), COMPAT_BIT(COMPAT_PF, 4), COMPAT_BIT(COMPAT_PA, 1));
+
 class DDRBClass {
   public:
     DDRBClass(PORT_t * portb, PORT_t * porte);
 
-    DDRBClass & operator  = (uint8_t const value);
-    DDRBClass & operator &= (uint8_t const value);
-    DDRBClass & operator |= (uint8_t const value);
+    operator uint8_t () const {
+      return COMPAT_READ(_portb, NANO_PORTB_MAP, COMPAT_PB, DIR) |
+             COMPAT_READ(_porte, NANO_PORTB_MAP, COMPAT_PE, DIR);
+    }
+
+    DDRBClass & operator  = (uint8_t const value) {
+      COMPAT_ASSIGN(_portb, NANO_PORTB_MAP, COMPAT_PB, DIRSET, DIRCLR, value);
+      COMPAT_ASSIGN(_porte, NANO_PORTB_MAP, COMPAT_PE, DIRSET, DIRCLR, value);
+      return *this;
+    }
+    DDRBClass & operator &= (uint8_t const value) {
+      COMPAT_CLEAR(_portb, NANO_PORTB_MAP, COMPAT_PB, DIRCLR, value);
+      COMPAT_CLEAR(_porte, NANO_PORTB_MAP, COMPAT_PE, DIRCLR, value);
+      return *this;
+    }
+    DDRBClass & operator |= (uint8_t const value) {
+      COMPAT_SET(_portb, NANO_PORTB_MAP, COMPAT_PB, DIRSET, value);
+      COMPAT_SET(_porte, NANO_PORTB_MAP, COMPAT_PE, DIRSET, value);
+      return *this;
+    }
+    DDRBClass & operator ^= (uint8_t const value) {
+      COMPAT_SET(_portb, NANO_PORTB_MAP, COMPAT_PB, DIRTGL, value);
+      COMPAT_SET(_porte, NANO_PORTB_MAP, COMPAT_PE, DIRTGL, value);
+      return *this;
+    }
   private: 
-    PORT_t * _portb , * _porte;   
+    PORT_t * _portb, * _porte;
 };
 
 class PORTBClass {
   public:
     PORTBClass(PORT_t * portb, PORT_t * porte);
 
-    PORTBClass & operator  = (uint8_t const value);
-    PORTBClass & operator &= (uint8_t const value);
-    PORTBClass & operator |= (uint8_t const value);
+    operator uint8_t () const {
+      return COMPAT_READ(_portb, NANO_PORTB_MAP, COMPAT_PB, OUT) |
+             COMPAT_READ(_porte, NANO_PORTB_MAP, COMPAT_PE, OUT);
+    }
+
+    PORTBClass & operator  = (uint8_t const value) {
+      COMPAT_ASSIGN(_portb, NANO_PORTB_MAP, COMPAT_PB, OUTSET, OUTCLR, value);
+      COMPAT_ASSIGN(_porte, NANO_PORTB_MAP, COMPAT_PE, OUTSET, OUTCLR, value);
+      return *this;
+    }
+    PORTBClass & operator &= (uint8_t const value) {
+      COMPAT_CLEAR(_portb, NANO_PORTB_MAP, COMPAT_PB, OUTCLR, value);
+      COMPAT_CLEAR(_porte, NANO_PORTB_MAP, COMPAT_PE, OUTCLR, value);
+      return *this;
+    }
+    PORTBClass & operator |= (uint8_t const value) {
+      COMPAT_SET(_portb, NANO_PORTB_MAP, COMPAT_PB, OUTSET, value);
+      COMPAT_SET(_porte, NANO_PORTB_MAP, COMPAT_PE, OUTSET, value);
+      return *this;
+    }
+    PORTBClass & operator ^= (uint8_t const value) {
+      COMPAT_SET(_portb, NANO_PORTB_MAP, COMPAT_PB, OUTTGL, value);
+      COMPAT_SET(_porte, NANO_PORTB_MAP, COMPAT_PE, OUTTGL, value);
+      return *this;
+    }
   private: 
-    PORT_t * _portb , * _porte;   
+    PORT_t * _portb, * _porte;
+};
+
+/* Reading PINB gathers the input bits, writing ones toggles the outputs */
+class PINBClass {
+  public:
+    PINBClass(PORT_t * portb, PORT_t * porte);
+
+    operator uint8_t () const {
+      return COMPAT_READ(_portb, NANO_PORTB_MAP, COMPAT_PB, IN) |
+             COMPAT_READ(_porte, NANO_PORTB_MAP, COMPAT_PE, IN);
+    }
+    PINBClass & operator  = (uint8_t const value) {
+      COMPAT_SET(_portb, NANO_PORTB_MAP, COMPAT_PB, OUTTGL, value);
+      COMPAT_SET(_porte, NANO_PORTB_MAP, COMPAT_PE, OUTTGL, value);
+      return *this;
+    }
+  private: 
+    PORT_t * _portb, * _porte;
 };
 
 /*****************************************************************************/
@@ -75,22 +146,83 @@ class DDRCClass {
   public:
     DDRCClass(PORT_t * porta, PORT_t * portd);
 
-    DDRCClass & operator  = (uint8_t const value);
-    DDRCClass & operator &= (uint8_t const value);
-    DDRCClass & operator |= (uint8_t const value);
+    operator uint8_t () const {
+      return COMPAT_READ(_porta, NANO_PORTC_MAP, COMPAT_PA, DIR) |
+             COMPAT_READ(_portd, NANO_PORTC_MAP, COMPAT_PD, DIR);
+    }
+
+    DDRCClass & operator  = (uint8_t const value) {
+      COMPAT_ASSIGN(_porta, NANO_PORTC_MAP, COMPAT_PA, DIRSET, DIRCLR, value);
+      COMPAT_ASSIGN(_portd, NANO_PORTC_MAP, COMPAT_PD, DIRSET, DIRCLR, value);
+      return *this;
+    }
+    DDRCClass & operator &= (uint8_t const value) {
+      COMPAT_CLEAR(_porta, NANO_PORTC_MAP, COMPAT_PA, DIRCLR, value);
+      COMPAT_CLEAR(_portd, NANO_PORTC_MAP, COMPAT_PD, DIRCLR, value);
+      return *this;
+    }
+    DDRCClass & operator |= (uint8_t const value) {
+      COMPAT_SET(_porta, NANO_PORTC_MAP, COMPAT_PA, DIRSET, value);
+      COMPAT_SET(_portd, NANO_PORTC_MAP, COMPAT_PD, DIRSET, value);
+      return *this;
+    }
+    DDRCClass & operator ^= (uint8_t const value) {
+      COMPAT_SET(_porta, NANO_PORTC_MAP, COMPAT_PA, DIRTGL, value);
+      COMPAT_SET(_portd, NANO_PORTC_MAP, COMPAT_PD, DIRTGL, value);
+      return *this;
+    }
   private: 
-    PORT_t * _porta , * _portd;   
+    PORT_t * _porta, * _portd;
 };
 
 class PORTCClass {
   public:
     PORTCClass(PORT_t * porta, PORT_t * portd);
 
-    PORTCClass & operator  = (uint8_t const value);
-    PORTCClass & operator &= (uint8_t const value);
-    PORTCClass & operator |= (uint8_t const value);
+    operator uint8_t () const {
+      return COMPAT_READ(_porta, NANO_PORTC_MAP, COMPAT_PA, OUT) |
+             COMPAT_READ(_portd, NANO_PORTC_MAP, COMPAT_PD, OUT);
+    }
+
+    PORTCClass & operator  = (uint8_t const value) {
+      COMPAT_ASSIGN(_porta, NANO_PORTC_MAP, COMPAT_PA, OUTSET, OUTCLR, value);
+      COMPAT_ASSIGN(_portd, NANO_PORTC_MAP, COMPAT_PD, OUTSET, OUTCLR, value);
+      return *this;
+    }
+    PORTCClass & operator &= (uint8_t const value) {
+      COMPAT_CLEAR(_porta, NANO_PORTC_MAP, COMPAT_PA, OUTCLR, value);
+      COMPAT_CLEAR(_portd, NANO_PORTC_MAP, COMPAT_PD, OUTCLR, value);
+      return *this;
+    }
+    PORTCClass & operator |= (uint8_t const value) {
+      COMPAT_SET(_porta, NANO_PORTC_MAP, COMPAT_PA, OUTSET, value);
+      COMPAT_SET(_portd, NANO_PORTC_MAP, COMPAT_PD, OUTSET, value);
+      return *this;
+    }
+    PORTCClass & operator ^= (uint8_t const value) {
+      COMPAT_SET(_porta, NANO_PORTC_MAP, COMPAT_PA, OUTTGL, value);
+      COMPAT_SET(_portd, NANO_PORTC_MAP, COMPAT_PD, OUTTGL, value);
+      return *this;
+    }
+  private: 
+    PORT_t * _porta, * _portd;
+};
+
+class PINCClass {
+  public:
+    PINCClass(PORT_t * porta, PORT_t * portd);
+
+    operator uint8_t () const {
+      return COMPAT_READ(_porta, NANO_PORTC_MAP, COMPAT_PA, IN) |
+             COMPAT_READ(_portd, NANO_PORTC_MAP, COMPAT_PD, IN);
+    }
+    PINCClass & operator  = (uint8_t const value) {
+      COMPAT_SET(_porta, NANO_PORTC_MAP, COMPAT_PA, OUTTGL, value);
+      COMPAT_SET(_portd, NANO_PORTC_MAP, COMPAT_PD, OUTTGL, value);
+      return *this;
+    }
   private: 
-    PORT_t * _porta , * _portd;   
+    PORT_t * _porta, * _portd;
 };
 
 /*****************************************************************************/
@@ -99,22 +231,107 @@ class DDRDClass {
   public:
     DDRDClass(PORT_t * porta, PORT_t * portb, PORT_t * portc, PORT_t * portf);
 
-    DDRDClass & operator  = (uint8_t const value);
-    DDRDClass & operator &= (uint8_t const value);
-    DDRDClass & operator |= (uint8_t const value);
+    operator uint8_t () const {
+      return COMPAT_READ(_porta, NANO_PORTD_MAP, COMPAT_PA, DIR) |
+             COMPAT_READ(_portb, NANO_PORTD_MAP, COMPAT_PB, DIR) |
+             COMPAT_READ(_portc, NANO_PORTD_MAP, COMPAT_PC, DIR) |
+             COMPAT_READ(_portf, NANO_PORTD_MAP, COMPAT_PF, DIR);
+    }
+
+    DDRDClass & operator  = (uint8_t const value) {
+      COMPAT_ASSIGN(_porta, NANO_PORTD_MAP, COMPAT_PA, DIRSET, DIRCLR, value);
+      COMPAT_ASSIGN(_portb, NANO_PORTD_MAP, COMPAT_PB, DIRSET, DIRCLR, value);
+      COMPAT_ASSIGN(_portc, NANO_PORTD_MAP, COMPAT_PC, DIRSET, DIRCLR, value);
+      COMPAT_ASSIGN(_portf, NANO_PORTD_MAP, COMPAT_PF, DIRSET, DIRCLR, value);
+      return *this;
+    }
+    DDRDClass & operator &= (uint8_t const value) {
+      COMPAT_CLEAR(_porta, NANO_PORTD_MAP, COMPAT_PA, DIRCLR, value);
+      COMPAT_CLEAR(_portb, NANO_PORTD_MAP, COMPAT_PB, DIRCLR, value);
+      COMPAT_CLEAR(_portc, NANO_PORTD_MAP, COMPAT_PC, DIRCLR, value);
+      COMPAT_CLEAR(_portf, NANO_PORTD_MAP, COMPAT_PF, DIRCLR, value);
+      return *this;
+    }
+    DDRDClass & operator |= (uint8_t const value) {
+      COMPAT_SET(_porta, NANO_PORTD_MAP, COMPAT_PA, DIRSET, value);
+      COMPAT_SET(_portb, NANO_PORTD_MAP, COMPAT_PB, DIRSET, value);
+      COMPAT_SET(_portc, NANO_PORTD_MAP, COMPAT_PC, DIRSET, value);
+      COMPAT_SET(_portf, NANO_PORTD_MAP, COMPAT_PF, DIRSET, value);
+      return *this;
+    }
+    DDRDClass & operator ^= (uint8_t const value) {
+      COMPAT_SET(_porta, NANO_PORTD_MAP, COMPAT_PA, DIRTGL, value);
+      COMPAT_SET(_portb, NANO_PORTD_MAP, COMPAT_PB, DIRTGL, value);
+      COMPAT_SET(_portc, NANO_PORTD_MAP, COMPAT_PC, DIRTGL, value);
+      COMPAT_SET(_portf, NANO_PORTD_MAP, COMPAT_PF, DIRTGL, value);
+      return *this;
+    }
   private: 
-    PORT_t * _porta, * _portb , * _portc, * _portf;   
+    PORT_t * _porta, * _portb, * _portc, * _portf;
 };
 
 class PORTDClass {
   public:
     PORTDClass(PORT_t * porta, PORT_t * portb, PORT_t * portc, PORT_t * portf);
 
-    PORTDClass & operator  = (uint8_t const value);
-    PORTDClass & operator &= (uint8_t const value);
-    PORTDClass & operator |= (uint8_t const value);
+    operator uint8_t () const {
+      return COMPAT_READ(_porta, NANO_PORTD_MAP, COMPAT_PA, OUT) |
+             COMPAT_READ(_portb, NANO_PORTD_MAP, COMPAT_PB, OUT) |
+             COMPAT_READ(_portc, NANO_PORTD_MAP, COMPAT_PC, OUT) |
+             COMPAT_READ(_portf, NANO_PORTD_MAP, COMPAT_PF, OUT);
+    }
+
+    PORTDClass & operator  = (uint8_t const value) {
+      COMPAT_ASSIGN(_porta, NANO_PORTD_MAP, COMPAT_PA, OUTSET, OUTCLR, value);
+      COMPAT_ASSIGN(_portb, NANO_PORTD_MAP, COMPAT_PB, OUTSET, OUTCLR, value);
+      COMPAT_ASSIGN(_portc, NANO_PORTD_MAP, COMPAT_PC, OUTSET, OUTCLR, value);
+      COMPAT_ASSIGN(_portf, NANO_PORTD_MAP, COMPAT_PF, OUTSET, OUTCLR, value);
+      return *this;
+    }
+    PORTDClass & operator &= (uint8_t const value) {
+      COMPAT_CLEAR(_porta, NANO_PORTD_MAP, COMPAT_PA, OUTCLR, value);
+      COMPAT_CLEAR(_portb, NANO_PORTD_MAP, COMPAT_PB, OUTCLR, value);
+      COMPAT_CLEAR(_portc, NANO_PORTD_MAP, COMPAT_PC, OUTCLR, value);
+      COMPAT_CLEAR(_portf, NANO_PORTD_MAP, COMPAT_PF, OUTCLR, value);
+      return *this;
+    }
+    PORTDClass & operator |= (uint8_t const value) {
+      COMPAT_SET(_porta, NANO_PORTD_MAP, COMPAT_PA, OUTSET, value);
+      COMPAT_SET(_portb, NANO_PORTD_MAP, COMPAT_PB, OUTSET, value);
+      COMPAT_SET(_portc, NANO_PORTD_MAP, COMPAT_PC, OUTSET, value);
+      COMPAT_SET(_portf, NANO_PORTD_MAP, COMPAT_PF, OUTSET, value);
+      return *this;
+    }
+    PORTDClass & operator ^= (uint8_t const value) {
+      COMPAT_SET(_porta, NANO_PORTD_MAP, COMPAT_PA, OUTTGL, value);
+      COMPAT_SET(_portb, NANO_PORTD_MAP, COMPAT_PB, OUTTGL, value);
+      COMPAT_SET(_portc, NANO_PORTD_MAP, COMPAT_PC, OUTTGL, value);
+      COMPAT_SET(_portf, NANO_PORTD_MAP, COMPAT_PF, OUTTGL, value);
+      return *this;
+    }
+  private: 
+    PORT_t * _porta, * _portb, * _portc, * _portf;
+};
+
+class PINDClass {
+  public:
+    PINDClass(PORT_t * porta, PORT_t * portb, PORT_t * portc, PORT_t * portf);
+
+    operator uint8_t () const {
+      return COMPAT_READ(_porta, NANO_PORTD_MAP, COMPAT_PA, IN) |
+             COMPAT_READ(_portb, NANO_PORTD_MAP, COMPAT_PB, IN) |
+             COMPAT_READ(_portc, NANO_PORTD_MAP, COMPAT_PC, IN) |
+             COMPAT_READ(_portf, NANO_PORTD_MAP, COMPAT_PF, IN);
+    }
+    PINDClass & operator  = (uint8_t const value) {
+      COMPAT_SET(_porta, NANO_PORTD_MAP, COMPAT_PA, OUTTGL, value);
+      COMPAT_SET(_portb, NANO_PORTD_MAP, COMPAT_PB, OUTTGL, value);
+      COMPAT_SET(_portc, NANO_PORTD_MAP, COMPAT_PC, OUTTGL, value);
+      COMPAT_SET(_portf, NANO_PORTD_MAP, COMPAT_PF, OUTTGL, value);
+      return *this;
+    }
   private: 
-    PORT_t * _porta, * _portb , * _portc, * _portf;   
+    PORT_t * _porta, * _portb, * _portc, * _portf;
 };
 
 /*****************************************************************************/
@@ -126,6 +343,9 @@ class PORTDClass {
   #undef PORTC
   #undef DDRD
   #undef PORTD
+  #undef PINB
+  #undef PINC
+  #undef PIND
 
   extern DDRBClass  DDRB;
   extern PORTBClass PORTB;
@@ -133,6 +353,10 @@ class PORTDClass {
   extern PORTCClass PORTC;
   extern DDRDClass  DDRD;
   extern PORTDClass PORTD;
+  extern PINBClass  PINB;
+  extern PINCClass  PINC;
+  extern PINDClass  PIND;
+  extern ADCSRAClass ADCSRA;
 #endif /* #ifndef HOST_BUILD */
 
 #endif /* #ifdef AVR_NANO_4809_328MODE */
\ No newline at end of file
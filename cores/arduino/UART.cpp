@@ -141,7 +141,7 @@ void UartClass::begin(unsigned long baud, uint16_t config)
     }
 
     int32_t baud_setting = (((8 * F_CPU) / baud) + 1) / 2;
-    int8_t sigrow_val = SIGROW.OSC16ERR5V;
+    int8_t sigrow_val = sigrowOscError(16, VCC_5V0);
     baud_setting += (baud_setting * sigrow_val) / 1024;
 
     //Make sure global interrupts are disabled during initialization
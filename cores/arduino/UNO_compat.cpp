@@ -27,4 +27,10 @@ DDRBClass DDRB;
 DDRCClass DDRC;
 DDRDClass DDRD;
 
+PINBClass PINB;
+PINCClass PINC;
+PINDClass PIND;
+
+ADCSRAClass ADCSRA;
+
 #endif /* #ifdef UNO_WIFI_REV2_328MODE */
\ No newline at end of file
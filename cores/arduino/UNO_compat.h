@@ -15,6 +15,7 @@
 
 #pragma once
 #include "Arduino.h"
+#include "Compat_remap.h"
 
 #ifdef UNO_WIFI_REV2_328MODE
 
@@ -52,47 +53,48 @@
 #undef PORTB
 #undef PORTC
 #undef PORTD
+#undef PINB
+#undef PINC
+#undef PIND
 
-#define SET_PORT_REGISTER(inPosition, port, position) if ((1 << inPosition) & (uint8_t)value) { port.OUTSET = (1 << position);}
-#define CLEAR_PORT_REGISTER(inPosition, port, position) if ((uint8_t)~(1 << inPosition) == (uint8_t)value) { port.OUTCLR = (1 << position);}
-#define SET_OR_CLEAR_PORT_REGISTER(inPosition, port, position) if ((uint8_t)~(1 << inPosition) & (uint8_t)value) { port.OUTSET = (1 << position); } else {port.OUTCLR = (1 << position); }
-
-#define SET_DIR_REGISTER(inPosition, port, position) if ((1 << inPosition) & (uint8_t)value) { port.DIRSET = (1 << position);}
-#define CLEAR_DIR_REGISTER(inPosition, port, position) if ((uint8_t)~(1 << inPosition) == (uint8_t)value) { port.DIRCLR = (1 << position);}
-#define SET_OR_CLEAR_DIR_REGISTER(inPosition, port, position) if ((uint8_t)~(1 << inPosition) & (uint8_t)value) { port.DIRSET = (1 << position); } else {port.DIRCLR = (1 << position); }
-
+/* 328 bit to 4809 bit, see the table above */
+static constexpr uint64_t UNO_PORTB_MAP = compat_map(COMPAT_BIT(COMPAT_PE, 3), COMPAT_BIT(COMPAT_PB, 0), COMPAT_BIT(COMPAT_PB, 1), COMPAT_BIT(COMPAT_PE, 0),
+                                                     COMPAT_BIT(COMPAT_PE, 1), COMPAT_BIT(COMPAT_PE, 2), COMPAT_NC,                COMPAT_NC);
+static constexpr uint64_t UNO_PORTC_MAP = compat_map(COMPAT_BIT(COMPAT_PD, 0), COMPAT_BIT(COMPAT_PD, 1), COMPAT_BIT(COMPAT_PD, 2), COMPAT_BIT(COMPAT_PD, 3),
+                                                     COMPAT_BIT(COMPAT_PD, 4), COMPAT_BIT(COMPAT_PD, 5), COMPAT_NC,                COMPAT_NC);
+static constexpr uint64_t UNO_PORTD_MAP = compat_map(COMPAT_BIT(COMPAT_PC, 5), COMPAT_BIT(COMPAT_PC, 4), COMPAT_BIT(COMPAT_PA, 0), COMPAT_BIT(COMPAT_PF, 5),
+                                                     COMPAT_BIT(COMPAT_PC, 6), COMPAT_BIT(COMPAT_PB, 2), COMPAT_BIT(COMPAT_PF, 4), COMPAT_BIT(COMPAT_PA, 1));
 
 /** DDR Classes**/
 class DDRBClass {
   public:
     DDRBClass() {}
+    operator uint8_t() const {
+      return COMPAT_READ(&PORTB_ARDUINO, UNO_PORTB_MAP, COMPAT_PB, DIR) |
+             COMPAT_READ(&PORTE_ARDUINO, UNO_PORTB_MAP, COMPAT_PE, DIR);
+    }
+
     DDRBClass& operator=(uint8_t value) {
-      SET_OR_CLEAR_DIR_REGISTER(0, PORTE_ARDUINO, 3);
-      SET_OR_CLEAR_DIR_REGISTER(1, PORTB_ARDUINO, 0);
-      SET_OR_CLEAR_DIR_REGISTER(2, PORTB_ARDUINO, 1);
-      SET_OR_CLEAR_DIR_REGISTER(3, PORTE_ARDUINO, 0);
-      SET_OR_CLEAR_DIR_REGISTER(4, PORTE_ARDUINO, 1);
-      SET_OR_CLEAR_DIR_REGISTER(5, PORTE_ARDUINO, 2);
+      COMPAT_ASSIGN(&PORTB_ARDUINO, UNO_PORTB_MAP, COMPAT_PB, DIRSET, DIRCLR, value);
+      COMPAT_ASSIGN(&PORTE_ARDUINO, UNO_PORTB_MAP, COMPAT_PE, DIRSET, DIRCLR, value);
       return *this;
     }
 
     DDRBClass& operator&=(uint8_t value) {
-      CLEAR_DIR_REGISTER(0, PORTE_ARDUINO, 3);
-      CLEAR_DIR_REGISTER(1, PORTB_ARDUINO, 0);
-      CLEAR_DIR_REGISTER(2, PORTB_ARDUINO, 1);
-      CLEAR_DIR_REGISTER(3, PORTE_ARDUINO, 0);
-      CLEAR_DIR_REGISTER(4, PORTE_ARDUINO, 1);
-      CLEAR_DIR_REGISTER(5, PORTE_ARDUINO, 2);
+      COMPAT_CLEAR(&PORTB_ARDUINO, UNO_PORTB_MAP, COMPAT_PB, DIRCLR, value);
+      COMPAT_CLEAR(&PORTE_ARDUINO, UNO_PORTB_MAP, COMPAT_PE, DIRCLR, value);
       return *this;
     }
 
     DDRBClass& operator|=(uint8_t value) {
-      SET_DIR_REGISTER(0, PORTE_ARDUINO, 3);
-      SET_DIR_REGISTER(1, PORTB_ARDUINO, 0);
-      SET_DIR_REGISTER(2, PORTB_ARDUINO, 1);
-      SET_DIR_REGISTER(3, PORTE_ARDUINO, 0);
-      SET_DIR_REGISTER(4, PORTE_ARDUINO, 1);
-      SET_DIR_REGISTER(5, PORTE_ARDUINO, 2);
+      COMPAT_SET(&PORTB_ARDUINO, UNO_PORTB_MAP, COMPAT_PB, DIRSET, value);
+      COMPAT_SET(&PORTE_ARDUINO, UNO_PORTB_MAP, COMPAT_PE, DIRSET, value);
+      return *this;
+    }
+
+    DDRBClass& operator^=(uint8_t value) {
+      COMPAT_SET(&PORTB_ARDUINO, UNO_PORTB_MAP, COMPAT_PB, DIRTGL, value);
+      COMPAT_SET(&PORTE_ARDUINO, UNO_PORTB_MAP, COMPAT_PE, DIRTGL, value);
       return *this;
     }
 };
@@ -100,33 +102,27 @@ class DDRBClass {
 class DDRCClass {
   public:
     DDRCClass() {}
+    operator uint8_t() const {
+      return COMPAT_READ(&PORTD_ARDUINO, UNO_PORTC_MAP, COMPAT_PD, DIR);
+    }
+
     DDRCClass& operator=(uint8_t value) {
-      SET_OR_CLEAR_DIR_REGISTER(0, PORTD_ARDUINO, 0);
-      SET_OR_CLEAR_DIR_REGISTER(1, PORTD_ARDUINO, 1);
-      SET_OR_CLEAR_DIR_REGISTER(2, PORTD_ARDUINO, 2);
-      SET_OR_CLEAR_DIR_REGISTER(3, PORTD_ARDUINO, 3);
-      SET_OR_CLEAR_DIR_REGISTER(4, PORTD_ARDUINO, 4);
-      SET_OR_CLEAR_DIR_REGISTER(5, PORTD_ARDUINO, 5);
+      COMPAT_ASSIGN(&PORTD_ARDUINO, UNO_PORTC_MAP, COMPAT_PD, DIRSET, DIRCLR, value);
       return *this;
     }
 
     DDRCClass& operator&=(uint8_t value) {
-      CLEAR_DIR_REGISTER(0, PORTD_ARDUINO, 0);
-      CLEAR_DIR_REGISTER(1, PORTD_ARDUINO, 1);
-      CLEAR_DIR_REGISTER(2, PORTD_ARDUINO, 2);
-      CLEAR_DIR_REGISTER(3, PORTD_ARDUINO, 3);
-      CLEAR_DIR_REGISTER(4, PORTD_ARDUINO, 4);
-      CLEAR_DIR_REGISTER(5, PORTD_ARDUINO, 5);
+      COMPAT_CLEAR(&PORTD_ARDUINO, UNO_PORTC_MAP, COMPAT_PD, DIRCLR, value);
       return *this;
     }
 
     DDRCClass& operator|=(uint8_t value) {
-      SET_DIR_REGISTER(0, PORTD_ARDUINO, 0);
-      SET_DIR_REGISTER(1, PORTD_ARDUINO, 1);
-      SET_DIR_REGISTER(2, PORTD_ARDUINO, 2);
-      SET_DIR_REGISTER(3, PORTD_ARDUINO, 3);
-      SET_DIR_REGISTER(4, PORTD_ARDUINO, 4);
-      SET_DIR_REGISTER(5, PORTD_ARDUINO, 5);
+      COMPAT_SET(&PORTD_ARDUINO, UNO_PORTC_MAP, COMPAT_PD, DIRSET, value);
+      return *this;
+    }
+
+    DDRCClass& operator^=(uint8_t value) {
+      COMPAT_SET(&PORTD_ARDUINO, UNO_PORTC_MAP, COMPAT_PD, DIRTGL, value);
       return *this;
     }
 };
@@ -134,73 +130,76 @@ class DDRCClass {
 class DDRDClass {
   public:
     DDRDClass() {}
+    operator uint8_t() const {
+      return COMPAT_READ(&PORTA_ARDUINO, UNO_PORTD_MAP, COMPAT_PA, DIR) |
+             COMPAT_READ(&PORTB_ARDUINO, UNO_PORTD_MAP, COMPAT_PB, DIR) |
+             COMPAT_READ(&PORTC_ARDUINO, UNO_PORTD_MAP, COMPAT_PC, DIR) |
+             COMPAT_READ(&PORTF_ARDUINO, UNO_PORTD_MAP, COMPAT_PF, DIR);
+    }
+
     DDRDClass& operator=(uint8_t value) {
-      SET_OR_CLEAR_DIR_REGISTER(0, PORTC_ARDUINO, 5);
-      SET_OR_CLEAR_DIR_REGISTER(1, PORTC_ARDUINO, 4);
-      SET_OR_CLEAR_DIR_REGISTER(2, PORTA_ARDUINO, 0);
-      SET_OR_CLEAR_DIR_REGISTER(3, PORTF_ARDUINO, 5);
-      SET_OR_CLEAR_DIR_REGISTER(4, PORTC_ARDUINO, 6);
-      SET_OR_CLEAR_DIR_REGISTER(5, PORTB_ARDUINO, 2);
-      SET_OR_CLEAR_DIR_REGISTER(6, PORTF_ARDUINO, 4);
-      SET_OR_CLEAR_DIR_REGISTER(7, PORTA_ARDUINO, 1);
+      COMPAT_ASSIGN(&PORTA_ARDUINO, UNO_PORTD_MAP, COMPAT_PA, DIRSET, DIRCLR, value);
+      COMPAT_ASSIGN(&PORTB_ARDUINO, UNO_PORTD_MAP, COMPAT_PB, DIRSET, DIRCLR, value);
+      COMPAT_ASSIGN(&PORTC_ARDUINO, UNO_PORTD_MAP, COMPAT_PC, DIRSET, DIRCLR, value);
+      COMPAT_ASSIGN(&PORTF_ARDUINO, UNO_PORTD_MAP, COMPAT_PF, DIRSET, DIRCLR, value);
       return *this;
     }
 
     DDRDClass& operator&=(uint8_t value) {
-      CLEAR_DIR_REGISTER(0, PORTC_ARDUINO, 5);
-      CLEAR_DIR_REGISTER(1, PORTC_ARDUINO, 4);
-      CLEAR_DIR_REGISTER(2, PORTA_ARDUINO, 0);
-      CLEAR_DIR_REGISTER(3, PORTF_ARDUINO, 5);
-      CLEAR_DIR_REGISTER(4, PORTC_ARDUINO, 6);
-      CLEAR_DIR_REGISTER(5, PORTB_ARDUINO, 2);
-      CLEAR_DIR_REGISTER(6, PORTF_ARDUINO, 4);
-      CLEAR_DIR_REGISTER(7, PORTA_ARDUINO, 1);
+      COMPAT_CLEAR(&PORTA_ARDUINO, UNO_PORTD_MAP, COMPAT_PA, DIRCLR, value);
+      COMPAT_CLEAR(&PORTB_ARDUINO, UNO_PORTD_MAP, COMPAT_PB, DIRCLR, value);
+      COMPAT_CLEAR(&PORTC_ARDUINO, UNO_PORTD_MAP, COMPAT_PC, DIRCLR, value);
+      COMPAT_CLEAR(&PORTF_ARDUINO, UNO_PORTD_MAP, COMPAT_PF, DIRCLR, value);
       return *this;
     }
 
     DDRDClass& operator|=(uint8_t value) {
-      SET_DIR_REGISTER(0, PORTC_ARDUINO, 5);
-      SET_DIR_REGISTER(1, PORTC_ARDUINO, 4);
-      SET_DIR_REGISTER(2, PORTA_ARDUINO, 0);
-      SET_DIR_REGISTER(3, PORTF_ARDUINO, 5);
-      SET_DIR_REGISTER(4, PORTC_ARDUINO, 6);
-      SET_DIR_REGISTER(5, PORTB_ARDUINO, 2);
-      SET_DIR_REGISTER(6, PORTF_ARDUINO, 4);
-      SET_DIR_REGISTER(7, PORTA_ARDUINO, 1);
+      COMPAT_SET(&PORTA_ARDUINO, UNO_PORTD_MAP, COMPAT_PA, DIRSET, value);
+      COMPAT_SET(&PORTB_ARDUINO, UNO_PORTD_MAP, COMPAT_PB, DIRSET, value);
+      COMPAT_SET(&PORTC_ARDUINO, UNO_PORTD_MAP, COMPAT_PC, DIRSET, value);
+      COMPAT_SET(&PORTF_ARDUINO, UNO_PORTD_MAP, COMPAT_PF, DIRSET, value);
+      return *this;
+    }
+
+    DDRDClass& operator^=(uint8_t value) {
+      COMPAT_SET(&PORTA_ARDUINO, UNO_PORTD_MAP, COMPAT_PA, DIRTGL, value);
+      COMPAT_SET(&PORTB_ARDUINO, UNO_PORTD_MAP, COMPAT_PB, DIRTGL, value);
+      COMPAT_SET(&PORTC_ARDUINO, UNO_PORTD_MAP, COMPAT_PC, DIRTGL, value);
+      COMPAT_SET(&PORTF_ARDUINO, UNO_PORTD_MAP, COMPAT_PF, DIRTGL, value);
       return *this;
     }
 };
+
 /** PORT Classes**/
 class PORTBClass {
   public:
     PORTBClass() {}
+    operator uint8_t() const {
+      return COMPAT_READ(&PORTB_ARDUINO, UNO_PORTB_MAP, COMPAT_PB, OUT) |
+             COMPAT_READ(&PORTE_ARDUINO, UNO_PORTB_MAP, COMPAT_PE, OUT);
+    }
+
     PORTBClass& operator=(uint8_t value) {
-      SET_OR_CLEAR_PORT_REGISTER(0, PORTE_ARDUINO, 3);
-      SET_OR_CLEAR_PORT_REGISTER(1, PORTB_ARDUINO, 0);
-      SET_OR_CLEAR_PORT_REGISTER(2, PORTB_ARDUINO, 1);
-      SET_OR_CLEAR_PORT_REGISTER(3, PORTE_ARDUINO, 0);
-      SET_OR_CLEAR_PORT_REGISTER(4, PORTE_ARDUINO, 1);
-      SET_OR_CLEAR_PORT_REGISTER(5, PORTE_ARDUINO, 2);
+      COMPAT_ASSIGN(&PORTB_ARDUINO, UNO_PORTB_MAP, COMPAT_PB, OUTSET, OUTCLR, value);
+      COMPAT_ASSIGN(&PORTE_ARDUINO, UNO_PORTB_MAP, COMPAT_PE, OUTSET, OUTCLR, value);
       return *this;
     }
 
     PORTBClass& operator&=(uint8_t value) {
-      CLEAR_PORT_REGISTER(0, PORTE_ARDUINO, 3);
-      CLEAR_PORT_REGISTER(1, PORTB_ARDUINO, 0);
-      CLEAR_PORT_REGISTER(2, PORTB_ARDUINO, 1);
-      CLEAR_PORT_REGISTER(3, PORTE_ARDUINO, 0);
-      CLEAR_PORT_REGISTER(4, PORTE_ARDUINO, 1);
-      CLEAR_PORT_REGISTER(5, PORTE_ARDUINO, 2);
+      COMPAT_CLEAR(&PORTB_ARDUINO, UNO_PORTB_MAP, COMPAT_PB, OUTCLR, value);
+      COMPAT_CLEAR(&PORTE_ARDUINO, UNO_PORTB_MAP, COMPAT_PE, OUTCLR, value);
       return *this;
     }
 
     PORTBClass& operator|=(uint8_t value) {
-      SET_PORT_REGISTER(0, PORTE_ARDUINO, 3);
-      SET_PORT_REGISTER(1, PORTB_ARDUINO, 0);
-      SET_PORT_REGISTER(2, PORTB_ARDUINO, 1);
-      SET_PORT_REGISTER(3, PORTE_ARDUINO, 0);
-      SET_PORT_REGISTER(4, PORTE_ARDUINO, 1);
-      SET_PORT_REGISTER(5, PORTE_ARDUINO, 2);
+      COMPAT_SET(&PORTB_ARDUINO, UNO_PORTB_MAP, COMPAT_PB, OUTSET, value);
+      COMPAT_SET(&PORTE_ARDUINO, UNO_PORTB_MAP, COMPAT_PE, OUTSET, value);
+      return *this;
+    }
+
+    PORTBClass& operator^=(uint8_t value) {
+      COMPAT_SET(&PORTB_ARDUINO, UNO_PORTB_MAP, COMPAT_PB, OUTTGL, value);
+      COMPAT_SET(&PORTE_ARDUINO, UNO_PORTB_MAP, COMPAT_PE, OUTTGL, value);
       return *this;
     }
 };
@@ -208,33 +207,27 @@ class PORTBClass {
 class PORTCClass {
   public:
     PORTCClass() {}
+    operator uint8_t() const {
+      return COMPAT_READ(&PORTD_ARDUINO, UNO_PORTC_MAP, COMPAT_PD, OUT);
+    }
+
     PORTCClass& operator=(uint8_t value) {
-      SET_OR_CLEAR_PORT_REGISTER(0, PORTD_ARDUINO, 0);
-      SET_OR_CLEAR_PORT_REGISTER(1, PORTD_ARDUINO, 1);
-      SET_OR_CLEAR_PORT_REGISTER(2, PORTD_ARDUINO, 2);
-      SET_OR_CLEAR_PORT_REGISTER(3, PORTD_ARDUINO, 3);
-      SET_OR_CLEAR_PORT_REGISTER(4, PORTD_ARDUINO, 4);
-      SET_OR_CLEAR_PORT_REGISTER(5, PORTD_ARDUINO, 5);
+      COMPAT_ASSIGN(&PORTD_ARDUINO, UNO_PORTC_MAP, COMPAT_PD, OUTSET, OUTCLR, value);
       return *this;
     }
 
     PORTCClass& operator&=(uint8_t value) {
-      CLEAR_PORT_REGISTER(0, PORTD_ARDUINO, 0);
-      CLEAR_PORT_REGISTER(1, PORTD_ARDUINO, 1);
-      CLEAR_PORT_REGISTER(2, PORTD_ARDUINO, 2);
-      CLEAR_PORT_REGISTER(3, PORTD_ARDUINO, 3);
-      CLEAR_PORT_REGISTER(4, PORTD_ARDUINO, 4);
-      CLEAR_PORT_REGISTER(5, PORTD_ARDUINO, 5);
+      COMPAT_CLEAR(&PORTD_ARDUINO, UNO_PORTC_MAP, COMPAT_PD, OUTCLR, value);
       return *this;
     }
 
     PORTCClass& operator|=(uint8_t value) {
-      SET_PORT_REGISTER(0, PORTD_ARDUINO, 0);
-      SET_PORT_REGISTER(1, PORTD_ARDUINO, 1);
-      SET_PORT_REGISTER(2, PORTD_ARDUINO, 2);
-      SET_PORT_REGISTER(3, PORTD_ARDUINO, 3);
-      SET_PORT_REGISTER(4, PORTD_ARDUINO, 4);
-      SET_PORT_REGISTER(5, PORTD_ARDUINO, 5);
+      COMPAT_SET(&PORTD_ARDUINO, UNO_PORTC_MAP, COMPAT_PD, OUTSET, value);
+      return *this;
+    }
+
+    PORTCClass& operator^=(uint8_t value) {
+      COMPAT_SET(&PORTD_ARDUINO, UNO_PORTC_MAP, COMPAT_PD, OUTTGL, value);
       return *this;
     }
 };
@@ -242,39 +235,90 @@ class PORTCClass {
 class PORTDClass {
   public:
     PORTDClass() {}
+    operator uint8_t() const {
+      return COMPAT_READ(&PORTA_ARDUINO, UNO_PORTD_MAP, COMPAT_PA, OUT) |
+             COMPAT_READ(&PORTB_ARDUINO, UNO_PORTD_MAP, COMPAT_PB, OUT) |
+             COMPAT_READ(&PORTC_ARDUINO, UNO_PORTD_MAP, COMPAT_PC, OUT) |
+             COMPAT_READ(&PORTF_ARDUINO, UNO_PORTD_MAP, COMPAT_PF, OUT);
+    }
+
     PORTDClass& operator=(uint8_t value) {
-      SET_OR_CLEAR_PORT_REGISTER(0, PORTC_ARDUINO, 5);
-      SET_OR_CLEAR_PORT_REGISTER(1, PORTC_ARDUINO, 4);
-      SET_OR_CLEAR_PORT_REGISTER(2, PORTA_ARDUINO, 0);
-      SET_OR_CLEAR_PORT_REGISTER(3, PORTF_ARDUINO, 5);
-      SET_OR_CLEAR_PORT_REGISTER(4, PORTC_ARDUINO, 6);
-      SET_OR_CLEAR_PORT_REGISTER(5, PORTB_ARDUINO, 2);
-      SET_OR_CLEAR_PORT_REGISTER(6, PORTF_ARDUINO, 4);
-      SET_OR_CLEAR_PORT_REGISTER(7, PORTA_ARDUINO, 1);
+      COMPAT_ASSIGN(&PORTA_ARDUINO, UNO_PORTD_MAP, COMPAT_PA, OUTSET, OUTCLR, value);
+      COMPAT_ASSIGN(&PORTB_ARDUINO, UNO_PORTD_MAP, COMPAT_PB, OUTSET, OUTCLR, value);
+      COMPAT_ASSIGN(&PORTC_ARDUINO, UNO_PORTD_MAP, COMPAT_PC, OUTSET, OUTCLR, value);
+      COMPAT_ASSIGN(&PORTF_ARDUINO, UNO_PORTD_MAP, COMPAT_PF, OUTSET, OUTCLR, value);
       return *this;
     }
 
     PORTDClass& operator&=(uint8_t value) {
-      CLEAR_PORT_REGISTER(0, PORTC_ARDUINO, 5);
-      CLEAR_PORT_REGISTER(1, PORTC_ARDUINO, 4);
-      CLEAR_PORT_REGISTER(2, PORTA_ARDUINO, 0);
-      CLEAR_PORT_REGISTER(3, PORTF_ARDUINO, 5);
-      CLEAR_PORT_REGISTER(4, PORTC_ARDUINO, 6);
-      CLEAR_PORT_REGISTER(5, PORTB_ARDUINO, 2);
-      CLEAR_PORT_REGISTER(6, PORTF_ARDUINO, 4);
-      CLEAR_PORT_REGISTER(7, PORTA_ARDUINO, 1);
+      COMPAT_CLEAR(&PORTA_ARDUINO, UNO_PORTD_MAP, COMPAT_PA, OUTCLR, value);
+      COMPAT_CLEAR(&PORTB_ARDUINO, UNO_PORTD_MAP, COMPAT_PB, OUTCLR, value);
+      COMPAT_CLEAR(&PORTC_ARDUINO, UNO_PORTD_MAP, COMPAT_PC, OUTCLR, value);
+      COMPAT_CLEAR(&PORTF_ARDUINO, UNO_PORTD_MAP, COMPAT_PF, OUTCLR, value);
       return *this;
     }
 
     PORTDClass& operator|=(uint8_t value) {
-      SET_PORT_REGISTER(0, PORTC_ARDUINO, 5);
-      SET_PORT_REGISTER(1, PORTC_ARDUINO, 4);
-      SET_PORT_REGISTER(2, PORTA_ARDUINO, 0);
-      SET_PORT_REGISTER(3, PORTF_ARDUINO, 5);
-      SET_PORT_REGISTER(4, PORTC_ARDUINO, 6);
-      SET_PORT_REGISTER(5, PORTB_ARDUINO, 2);
-      SET_PORT_REGISTER(6, PORTF_ARDUINO, 4);
-      SET_PORT_REGISTER(7, PORTA_ARDUINO, 1);
+      COMPAT_SET(&PORTA_ARDUINO, UNO_PORTD_MAP, COMPAT_PA, OUTSET, value);
+      COMPAT_SET(&PORTB_ARDUINO, UNO_PORTD_MAP, COMPAT_PB, OUTSET, value);
+      COMPAT_SET(&PORTC_ARDUINO, UNO_PORTD_MAP, COMPAT_PC, OUTSET, value);
+      COMPAT_SET(&PORTF_ARDUINO, UNO_PORTD_MAP, COMPAT_PF, OUTSET, value);
+      return *this;
+    }
+
+    PORTDClass& operator^=(uint8_t value) {
+      COMPAT_SET(&PORTA_ARDUINO, UNO_PORTD_MAP, COMPAT_PA, OUTTGL, value);
+      COMPAT_SET(&PORTB_ARDUINO, UNO_PORTD_MAP, COMPAT_PB, OUTTGL, value);
+      COMPAT_SET(&PORTC_ARDUINO, UNO_PORTD_MAP, COMPAT_PC, OUTTGL, value);
+      COMPAT_SET(&PORTF_ARDUINO, UNO_PORTD_MAP, COMPAT_PF, OUTTGL, value);
+      return *this;
+    }
+};
+
+/** PIN Classes, reading gathers the input bits, writing ones toggles the outputs **/
+class PINBClass {
+  public:
+    PINBClass() {}
+    operator uint8_t() const {
+      return COMPAT_READ(&PORTB_ARDUINO, UNO_PORTB_MAP, COMPAT_PB, IN) |
+             COMPAT_READ(&PORTE_ARDUINO, UNO_PORTB_MAP, COMPAT_PE, IN);
+    }
+
+    PINBClass& operator=(uint8_t value) {
+      COMPAT_SET(&PORTB_ARDUINO, UNO_PORTB_MAP, COMPAT_PB, OUTTGL, value);
+      COMPAT_SET(&PORTE_ARDUINO, UNO_PORTB_MAP, COMPAT_PE, OUTTGL, value);
+      return *this;
+    }
+};
+
+class PINCClass {
+  public:
+    PINCClass() {}
+    operator uint8_t() const {
+      return COMPAT_READ(&PORTD_ARDUINO, UNO_PORTC_MAP, COMPAT_PD, IN);
+    }
+
+    PINCClass& operator=(uint8_t value) {
+      COMPAT_SET(&PORTD_ARDUINO, UNO_PORTC_MAP, COMPAT_PD, OUTTGL, value);
+      return *this;
+    }
+};
+
+class PINDClass {
+  public:
+    PINDClass() {}
+    operator uint8_t() const {
+      return COMPAT_READ(&PORTA_ARDUINO, UNO_PORTD_MAP, COMPAT_PA, IN) |
+             COMPAT_READ(&PORTB_ARDUINO, UNO_PORTD_MAP, COMPAT_PB, IN) |
+             COMPAT_READ(&PORTC_ARDUINO, UNO_PORTD_MAP, COMPAT_PC, IN) |
+             COMPAT_READ(&PORTF_ARDUINO, UNO_PORTD_MAP, COMPAT_PF, IN);
+    }
+
+    PINDClass& operator=(uint8_t value) {
+      COMPAT_SET(&PORTA_ARDUINO, UNO_PORTD_MAP, COMPAT_PA, OUTTGL, value);
+      COMPAT_SET(&PORTB_ARDUINO, UNO_PORTD_MAP, COMPAT_PB, OUTTGL, value);
+      COMPAT_SET(&PORTC_ARDUINO, UNO_PORTD_MAP, COMPAT_PC, OUTTGL, value);
+      COMPAT_SET(&PORTF_ARDUINO, UNO_PORTD_MAP, COMPAT_PF, OUTTGL, value);
       return *this;
     }
 };
@@ -285,5 +329,9 @@ extern PORTDClass PORTD;
 extern DDRBClass DDRB;
 extern DDRCClass DDRC;
 extern DDRDClass DDRD;
+extern PINBClass PINB;
+extern PINCClass PINC;
+extern PINDClass PIND;
+extern ADCSRAClass ADCSRA;
 
 #endif /* #ifdef UNO_WIFI_REV2_328MODE */
\ No newline at end of file
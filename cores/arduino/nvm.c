@@ -0,0 +1,232 @@
+/*
+  nvm.c - Signature row, user row and flash access for megaAVR
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include "wiring_private.h"
+
+/******************************** SIGNATURE ROW *******************************/
+
+uint32_t sigrowDeviceId()
+{
+	return ((uint32_t)SIGROW.DEVICEID0 << 16) | ((uint16_t)SIGROW.DEVICEID1 << 8) | SIGROW.DEVICEID2;
+}
+
+void sigrowSerialNumber(uint8_t *serial)
+{
+	const volatile uint8_t *sernum = &SIGROW.SERNUM0;
+
+	for(uint8_t i = 0; i < SIGROW_SERIAL_SIZE; i++) {
+		serial[i] = sernum[i];
+	}
+}
+
+/* Factory measured error of the internal oscillator, in units of 1/1024,
+	for the given oscillator frequency (16 or 20 MHz) and supply (VCC_xxx) */
+int8_t sigrowOscError(uint8_t mhz, uint8_t vcc)
+{
+	if(mhz == 20) {
+		return (vcc == VCC_5V0) ? SIGROW.OSC20ERR5V : SIGROW.OSC20ERR3V;
+	}
+	return (vcc == VCC_5V0) ? SIGROW.OSC16ERR5V : SIGROW.OSC16ERR3V;
+}
+
+/* Temperature sensor calibration, see the ADC chapter of the datasheet.
+	T[K] = ((ADC result - offset) * gain + 128) / 256, with the 1.1V reference */
+uint8_t sigrowTempSenseGain()
+{
+	return SIGROW.TEMPSENSE0;
+}
+
+int8_t sigrowTempSenseOffset()
+{
+	return SIGROW.TEMPSENSE1;
+}
+
+/********************************** USER ROW **********************************/
+
+/* Disable interrupts once the NVM controller is idle, returning the old SREG.
+	An EEPROM write queued from an interrupt must not get in between */
+static uint8_t nvmReadyCli()
+{
+	uint8_t oldSREG = SREG;
+
+	for(;;) {
+		cli();
+		if(!(NVMCTRL.STATUS & (NVMCTRL_EEBUSY_bm | NVMCTRL_FBUSY_bm))) return oldSREG;
+		SREG = oldSREG;
+	}
+}
+
+uint8_t userRowRead(uint8_t offset)
+{
+	if(offset >= USER_ROW_SIZE) return 0xFF;
+	return ((volatile uint8_t *)&USERROW)[offset];
+}
+
+void userRowReadBlock(uint8_t offset, void *dst, uint8_t len)
+{
+	uint8_t *ptr = (uint8_t *)dst;
+
+	while(len--) *ptr++ = userRowRead(offset++);
+}
+
+/* The user row is a single page. Changed bytes are loaded into the page
+	buffer and written with one erase/write, leaving the other bytes as they are */
+bool userRowWriteBlock(uint8_t offset, const void *src, uint8_t len)
+{
+	volatile uint8_t *row = (volatile uint8_t *)&USERROW + offset;
+	const uint8_t *ptr = (const uint8_t *)src;
+	bool dirty = false;
+
+	if((uint16_t)offset + len > USER_ROW_SIZE) return false;
+
+	uint8_t oldSREG = nvmReadyCli();
+	_PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEBUFCLR_gc);
+	for(uint8_t i = 0; i < len; i++) {
+		if(row[i] != ptr[i]) {
+			row[i] = ptr[i];
+			dirty = true;
+		}
+	}
+	if(dirty) {
+		_PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
+	}
+	SREG = oldSREG;
+
+	/* Wait for the write so the user row reads back the new data */
+	while(NVMCTRL.STATUS & NVMCTRL_EEBUSY_bm);
+	return true;
+}
+
+bool userRowWrite(uint8_t offset, uint8_t value)
+{
+	return userRowWriteBlock(offset, &value, 1);
+}
+
+/*********************************** FLASH ************************************/
+
+/* Code in the BOOT or APPCODE section may only write the APPDATA section.
+	This is set up with the BOOTEND and APPEND fuses, in units of 256 bytes:
+	APPDATA starts at APPEND, or right after BOOT if APPEND <= BOOTEND.
+	With BOOTEND 0 all of the flash is BOOT and there is no APPDATA */
+uint16_t flashAppDataStart()
+{
+	uint8_t bootend = FUSE.BOOTEND;
+	uint8_t append = FUSE.APPEND;
+
+	if(bootend == 0 || append == 0) return PROGMEM_SIZE;
+	return (uint16_t)((append > bootend) ? append : bootend) << 8;
+}
+
+uint16_t flashAppDataSize()
+{
+	return PROGMEM_SIZE - flashAppDataStart();
+}
+
+static bool flashInAppData(uint16_t addr, uint16_t len)
+{
+	return addr >= flashAppDataStart() && len <= PROGMEM_SIZE - addr;
+}
+
+/* Run an NVM command and wait for it. The command applies to the page
+	that was last written to in the page buffer */
+static void flashCommand(uint8_t cmd)
+{
+	_PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, cmd);
+	while(NVMCTRL.STATUS & NVMCTRL_FBUSY_bm);
+}
+
+void flashRead(uint16_t addr, void *dst, uint16_t len)
+{
+	memcpy_P(dst, (const void *)addr, len);
+}
+
+bool flashPageErase(uint16_t addr)
+{
+	if(!flashInAppData(addr, 1)) return false;
+
+	uint8_t oldSREG = nvmReadyCli();
+	_PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEBUFCLR_gc);
+	*(volatile uint8_t *)(MAPPED_PROGMEM_START + addr) = 0xFF;
+	flashCommand(NVMCTRL_CMD_PAGEERASE_gc);
+	SREG = oldSREG;
+	return true;
+}
+
+/* Program len bytes at addr, which must not cross a page boundary, without
+	erasing. Bits can only go from 1 to 0, so the bytes should be erased first */
+bool flashPageWrite(uint16_t addr, const void *src, uint8_t len)
+{
+	volatile uint8_t *page = (volatile uint8_t *)(MAPPED_PROGMEM_START + addr);
+	const uint8_t *ptr = (const uint8_t *)src;
+
+	if(!flashInAppData(addr, len) || len == 0 || (addr % PROGMEM_PAGE_SIZE) + len > PROGMEM_PAGE_SIZE) return false;
+
+	uint8_t oldSREG = nvmReadyCli();
+	_PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEBUFCLR_gc);
+	for(uint8_t i = 0; i < len; i++) {
+		page[i] = ptr[i];
+	}
+	flashCommand(NVMCTRL_CMD_PAGEWRITE_gc);
+	SREG = oldSREG;
+	return true;
+}
+
+/* Write any range of APPDATA. Each page touched is written once: without
+	erasing if only bits going from 1 to 0 are needed, otherwise the whole
+	page is loaded with the old data merged in and erased and written */
+bool flashWrite(uint16_t addr, const void *src, uint16_t len)
+{
+	const uint8_t *ptr = (const uint8_t *)src;
+
+	if(!flashInAppData(addr, len)) return false;
+
+	while(len) {
+		uint16_t start = addr & ~(PROGMEM_PAGE_SIZE - 1);
+		uint8_t offset = addr - start;
+		uint8_t n = PROGMEM_PAGE_SIZE - offset;
+		if(n > len) n = len;
+
+		const volatile uint8_t *page = (const volatile uint8_t *)(MAPPED_PROGMEM_START + start);
+		bool changed = false, erase = false;
+		for(uint8_t i = 0; i < n; i++) {
+			uint8_t old = page[offset + i];
+			if(old != ptr[i]) changed = true;
+			if(ptr[i] & ~old) erase = true;
+		}
+
+		if(erase) {
+			uint8_t oldSREG = nvmReadyCli();
+			_PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEBUFCLR_gc);
+			for(uint8_t i = 0; i < PROGMEM_PAGE_SIZE; i++) {
+				uint8_t b = (uint8_t)(i - offset) < n ? ptr[i - offset] : page[i];
+				((volatile uint8_t *)page)[i] = b;
+			}
+			flashCommand(NVMCTRL_CMD_PAGEERASEWRITE_gc);
+			SREG = oldSREG;
+		} else if(changed) {
+			flashPageWrite(addr, ptr, n);
+		}
+
+		addr += n;
+		ptr += n;
+		len -= n;
+	}
+	return true;
+}
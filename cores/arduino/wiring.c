@@ -292,6 +292,13 @@ void init()
 {
 	// this needs to be called before setup() or some functions won't
 	// work there
+
+#ifdef VECTORS_IN_BOOT_SECTION
+	/* The sketch starts at address 0, but BOOTEND has been set so that it can
+		write the APPDATA section. Its interrupt vectors are then at the start
+		of the BOOT section rather than the APPCODE section */
+	_PROTECTED_WRITE(CPUINT.CTRLA, CPUINT_IVSEL_bm);
+#endif
 	
 /******************************** CLOCK STUFF *********************************/
 
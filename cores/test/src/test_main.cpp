@@ -19,7 +19,11 @@
 #define CATCH_CONFIG_MAIN
 #include <catch2/catch.hpp>
 
+#include <algorithm>
+#include <cmath>
+
 #include "../../arduino/NANO_Compat.h"
+#include "../../../libraries/SoftwareSerial/src/SoftwareSerialTiming.h"
 
 /*****************************************************************************/
 
@@ -291,4 +295,273 @@ SCENARIO("Testing Arduino Nano 4809 PORTD compatibility class", "NANO_Compat::PO
     WHEN("ATMEGA328P PORTD |= (1<<6)") { PORTD |= (1<<6); THEN("ATMEGA4809 PORTF.OUT = (1<<4)") REQUIRE(portf.OUT.val() == (1<<4)); }
     WHEN("ATMEGA328P PORTD |= (1<<7)") { PORTD |= (1<<7); THEN("ATMEGA4809 PORTA.OUT = (1<<1)") REQUIRE(porta.OUT.val() == (1<<1)); }
   }
-}
\ No newline at end of file
+}
+
+/*****************************************************************************/
+
+SCENARIO("Testing Arduino Nano 4809 PINB compatibility class", "NANO_Compat::PINBClass") {
+  PORT_t portb, porte;
+
+  PINBClass PINB(&portb, &porte);
+
+  REQUIRE(PINB == 0);
+
+  GIVEN("Testing reading ") {
+    WHEN("ATMEGA4809 PORTE.IN = (1<<3)") { porte.IN.set(1<<3); THEN("ATMEGA328P PINB = (1<<0)") REQUIRE(PINB == (1<<0)); }
+    WHEN("ATMEGA4809 PORTB.IN = (1<<0)") { portb.IN.set(1<<0); THEN("ATMEGA328P PINB = (1<<1)") REQUIRE(PINB == (1<<1)); }
+    WHEN("ATMEGA4809 PORTB.IN = (1<<1)") { portb.IN.set(1<<1); THEN("ATMEGA328P PINB = (1<<2)") REQUIRE(PINB == (1<<2)); }
+    WHEN("ATMEGA4809 PORTE.IN = (1<<0)") { porte.IN.set(1<<0); THEN("ATMEGA328P PINB = (1<<3)") REQUIRE(PINB == (1<<3)); }
+    WHEN("ATMEGA4809 PORTE.IN = (1<<1)") { porte.IN.set(1<<1); THEN("ATMEGA328P PINB = (1<<4)") REQUIRE(PINB == (1<<4)); }
+    WHEN("ATMEGA4809 PORTE.IN = (1<<2)") { porte.IN.set(1<<2); THEN("ATMEGA328P PINB = (1<<5)") REQUIRE(PINB == (1<<5)); }
+  }
+
+  GIVEN("Testing operator = ") {
+    portb.OUT.set(0xFF);
+    porte.OUT.set(0xFF);
+    WHEN("ATMEGA328P PINB = (1<<0)") { PINB = (1<<0); THEN("ATMEGA4809 PORTE.OUT = 0xF7") REQUIRE(porte.OUT.val() == 0xF7); }
+    WHEN("ATMEGA328P PINB = (1<<1)") { PINB = (1<<1); THEN("ATMEGA4809 PORTB.OUT = 0xFE") REQUIRE(portb.OUT.val() == 0xFE); }
+    WHEN("ATMEGA328P PINB = (1<<2)") { PINB = (1<<2); THEN("ATMEGA4809 PORTB.OUT = 0xFD") REQUIRE(portb.OUT.val() == 0xFD); }
+    WHEN("ATMEGA328P PINB = (1<<3)") { PINB = (1<<3); THEN("ATMEGA4809 PORTE.OUT = 0xFE") REQUIRE(porte.OUT.val() == 0xFE); }
+    WHEN("ATMEGA328P PINB = (1<<4)") { PINB = (1<<4); THEN("ATMEGA4809 PORTE.OUT = 0xFD") REQUIRE(porte.OUT.val() == 0xFD); }
+    WHEN("ATMEGA328P PINB = (1<<5)") { PINB = (1<<5); THEN("ATMEGA4809 PORTE.OUT = 0xFB") REQUIRE(porte.OUT.val() == 0xFB); }
+  }
+}
+
+/*****************************************************************************/
+
+SCENARIO("Testing Arduino Nano 4809 PINC compatibility class", "NANO_Compat::PINCClass") {
+  PORT_t porta, portd;
+
+  PINCClass PINC(&porta, &portd);
+
+  REQUIRE(PINC == 0);
+
+  GIVEN("Testing reading ") {
+    WHEN("ATMEGA4809 PORTD.IN = (1<<3)") { portd.IN.set(1<<3); THEN("ATMEGA328P PINC = (1<<0)") REQUIRE(PINC == (1<<0)); }
+    WHEN("ATMEGA4809 PORTD.IN = (1<<2)") { portd.IN.set(1<<2); THEN("ATMEGA328P PINC = (1<<1)") REQUIRE(PINC == (1<<1)); }
+    WHEN("ATMEGA4809 PORTD.IN = (1<<1)") { portd.IN.set(1<<1); THEN("ATMEGA328P PINC = (1<<2)") REQUIRE(PINC == (1<<2)); }
+    WHEN("ATMEGA4809 PORTD.IN = (1<<0)") { portd.IN.set(1<<0); THEN("ATMEGA328P PINC = (1<<3)") REQUIRE(PINC == (1<<3)); }
+    WHEN("ATMEGA4809 PORTA.IN = (1<<2)") { porta.IN.set(1<<2); THEN("ATMEGA328P PINC = (1<<4)") REQUIRE(PINC == (1<<4)); }
+    WHEN("ATMEGA4809 PORTA.IN = (1<<3)") { porta.IN.set(1<<3); THEN("ATMEGA328P PINC = (1<<5)") REQUIRE(PINC == (1<<5)); }
+    WHEN("ATMEGA4809 PORTD.IN = (1<<4)") { portd.IN.set(1<<4); THEN("ATMEGA328P PINC = (1<<6)") REQUIRE(PINC == (1<<6)); }
+    WHEN("ATMEGA4809 PORTD.IN = (1<<5)") { portd.IN.set(1<<5); THEN("ATMEGA328P PINC = (1<<7)") REQUIRE(PINC == (1<<7)); }
+  }
+
+  GIVEN("Testing operator = ") {
+    porta.OUT.set(0xFF);
+    portd.OUT.set(0xFF);
+    WHEN("ATMEGA328P PINC = (1<<0)") { PINC = (1<<0); THEN("ATMEGA4809 PORTD.OUT = 0xF7") REQUIRE(portd.OUT.val() == 0xF7); }
+    WHEN("ATMEGA328P PINC = (1<<1)") { PINC = (1<<1); THEN("ATMEGA4809 PORTD.OUT = 0xFB") REQUIRE(portd.OUT.val() == 0xFB); }
+    WHEN("ATMEGA328P PINC = (1<<2)") { PINC = (1<<2); THEN("ATMEGA4809 PORTD.OUT = 0xFD") REQUIRE(portd.OUT.val() == 0xFD); }
+    WHEN("ATMEGA328P PINC = (1<<3)") { PINC = (1<<3); THEN("ATMEGA4809 PORTD.OUT = 0xFE") REQUIRE(portd.OUT.val() == 0xFE); }
+    WHEN("ATMEGA328P PINC = (1<<4)") { PINC = (1<<4); THEN("ATMEGA4809 PORTA.OUT = 0xFB") REQUIRE(porta.OUT.val() == 0xFB); }
+    WHEN("ATMEGA328P PINC = (1<<5)") { PINC = (1<<5); THEN("ATMEGA4809 PORTA.OUT = 0xF7") REQUIRE(porta.OUT.val() == 0xF7); }
+    WHEN("ATMEGA328P PINC = (1<<6)") { PINC = (1<<6); THEN("ATMEGA4809 PORTD.OUT = 0xEF") REQUIRE(portd.OUT.val() == 0xEF); }
+    WHEN("ATMEGA328P PINC = (1<<7)") { PINC = (1<<7); THEN("ATMEGA4809 PORTD.OUT = 0xDF") REQUIRE(portd.OUT.val() == 0xDF); }
+  }
+}
+
+/*****************************************************************************/
+
+SCENARIO("Testing Arduino Nano 4809 PIND compatibility class", "NANO_Compat::PINDClass") {
+  PORT_t porta, portb, portc, portf;
+
+  PINDClass PIND(&porta, &portb, &portc, &portf);
+
+  REQUIRE(PIND == 0);
+
+  GIVEN("Testing reading ") {
+    WHEN("ATMEGA4809 PORTC.IN = (1<<4)") { portc.IN.set(1<<4); THEN("ATMEGA328P PIND = (1<<0)") REQUIRE(PIND == (1<<0)); }
+    WHEN("ATMEGA4809 PORTC.IN = (1<<5)") { portc.IN.set(1<<5); THEN("ATMEGA328P PIND = (1<<1)") REQUIRE(PIND == (1<<1)); }
+    WHEN("ATMEGA4809 PORTA.IN = (1<<0)") { porta.IN.set(1<<0); THEN("ATMEGA328P PIND = (1<<2)") REQUIRE(PIND == (1<<2)); }
+    WHEN("ATMEGA4809 PORTF.IN = (1<<5)") { portf.IN.set(1<<5); THEN("ATMEGA328P PIND = (1<<3)") REQUIRE(PIND == (1<<3)); }
+    WHEN("ATMEGA4809 PORTC.IN = (1<<6)") { portc.IN.set(1<<6); THEN("ATMEGA328P PIND = (1<<4)") REQUIRE(PIND == (1<<4)); }
+    WHEN("ATMEGA4809 PORTB.IN = (1<<2)") { portb.IN.set(1<<2); THEN("ATMEGA328P PIND = (1<<5)") REQUIRE(PIND == (1<<5)); }
+    WHEN("ATMEGA4809 PORTF.IN = (1<<4)") { portf.IN.set(1<<4); THEN("ATMEGA328P PIND = (1<<6)") REQUIRE(PIND == (1<<6)); }
+    WHEN("ATMEGA4809 PORTA.IN = (1<<1)") { porta.IN.set(1<<1); THEN("ATMEGA328P PIND = (1<<7)") REQUIRE(PIND == (1<<7)); }
+  }
+
+  GIVEN("Testing operator = ") {
+    porta.OUT.set(0xFF);
+    portb.OUT.set(0xFF);
+    portc.OUT.set(0xFF);
+    portf.OUT.set(0xFF);
+    WHEN("ATMEGA328P PIND = (1<<0)") { PIND = (1<<0); THEN("ATMEGA4809 PORTC.OUT = 0xEF") REQUIRE(portc.OUT.val() == 0xEF); }
+    WHEN("ATMEGA328P PIND = (1<<1)") { PIND = (1<<1); THEN("ATMEGA4809 PORTC.OUT = 0xDF") REQUIRE(portc.OUT.val() == 0xDF); }
+    WHEN("ATMEGA328P PIND = (1<<2)") { PIND = (1<<2); THEN("ATMEGA4809 PORTA.OUT = 0xFE") REQUIRE(porta.OUT.val() == 0xFE); }
+    WHEN("ATMEGA328P PIND = (1<<3)") { PIND = (1<<3); THEN("ATMEGA4809 PORTF.OUT = 0xDF") REQUIRE(portf.OUT.val() == 0xDF); }
+    WHEN("ATMEGA328P PIND = (1<<4)") { PIND = (1<<4); THEN("ATMEGA4809 PORTC.OUT = 0xBF") REQUIRE(portc.OUT.val() == 0xBF); }
+    WHEN("ATMEGA328P PIND = (1<<5)") { PIND = (1<<5); THEN("ATMEGA4809 PORTB.OUT = 0xFB") REQUIRE(portb.OUT.val() == 0xFB); }
+    WHEN("ATMEGA328P PIND = (1<<6)") { PIND = (1<<6); THEN("ATMEGA4809 PORTF.OUT = 0xEF") REQUIRE(portf.OUT.val() == 0xEF); }
+    WHEN("ATMEGA328P PIND = (1<<7)") { PIND = (1<<7); THEN("ATMEGA4809 PORTA.OUT = 0xFD") REQUIRE(porta.OUT.val() == 0xFD); }
+  }
+}
+
+/*****************************************************************************/
+
+SCENARIO("Testing Arduino Nano 4809 reading back and toggling PORTx and DDRx", "NANO_Compat::PORTDClass") {
+  PORT_t porta, portb, portc, portf;
+
+  DDRDClass  DDRD (&porta, &portb, &portc, &portf);
+  PORTDClass PORTD(&porta, &portb, &portc, &portf);
+
+  GIVEN("Testing reading ") {
+    WHEN("ATMEGA328P PORTD = 0xA5") { PORTD = 0xA5; THEN("ATMEGA328P PORTD reads 0xA5") REQUIRE(PORTD == 0xA5); }
+    WHEN("ATMEGA328P PORTD = 0x5A") { PORTD = 0x5A; THEN("ATMEGA328P PORTD reads 0x5A") REQUIRE(PORTD == 0x5A); }
+    WHEN("ATMEGA328P DDRD = 0x3C")  { DDRD = 0x3C;  THEN("ATMEGA328P DDRD reads 0x3C")  REQUIRE(DDRD == 0x3C); }
+    WHEN("ATMEGA328P DDRD = 0xC3")  { DDRD = 0xC3;  THEN("ATMEGA328P DDRD reads 0xC3")  REQUIRE(DDRD == 0xC3); }
+  }
+
+  GIVEN("Testing operator ^= ") {
+    PORTD = 0x0F;
+    WHEN("ATMEGA328P PORTD ^= 0xFF") { PORTD ^= 0xFF; THEN("ATMEGA328P PORTD reads 0xF0") REQUIRE(PORTD == 0xF0); }
+    WHEN("ATMEGA328P PORTD ^= (1<<0)") { PORTD ^= (1<<0); THEN("ATMEGA4809 PORTC.OUT = (1<<5)") REQUIRE(portc.OUT.val() == (1<<5)); }
+    WHEN("ATMEGA328P DDRD ^= (1<<7)") { DDRD ^= (1<<7); THEN("ATMEGA4809 PORTA.DIR = (1<<1)") REQUIRE(porta.DIR.val() == (1<<1)); }
+  }
+}
+
+/*****************************************************************************/
+
+SCENARIO("Testing the per port masks derived from the Nano 4809 maps", "Compat_remap::compat_port") {
+  GIVEN("ATMEGA328P PORTB") {
+    STATIC_REQUIRE(compat_port<NANO_PORTB_MAP, COMPAT_PB>::span == 0x06);
+    STATIC_REQUIRE(compat_port<NANO_PORTB_MAP, COMPAT_PB>::shift == -1);
+    STATIC_REQUIRE(compat_port<NANO_PORTB_MAP, COMPAT_PB>::shifted);
+    STATIC_REQUIRE(compat_port<NANO_PORTB_MAP, COMPAT_PE>::span == 0x39);
+    STATIC_REQUIRE(!compat_port<NANO_PORTB_MAP, COMPAT_PE>::shifted);
+    STATIC_REQUIRE(compat_port<NANO_PORTB_MAP, COMPAT_PB>::mask(0xFF) == 0x03);
+    STATIC_REQUIRE(compat_port<NANO_PORTB_MAP, COMPAT_PE>::mask(0xFF) == 0x0F);
+    STATIC_REQUIRE(compat_port<NANO_PORTB_MAP, COMPAT_PE>::mask(1<<0) == (1<<3));
+    STATIC_REQUIRE(compat_port<NANO_PORTB_MAP, COMPAT_PE>::gather(1<<3) == (1<<0));
+  }
+
+  GIVEN("ATMEGA328P PORTC") {
+    STATIC_REQUIRE(compat_port<NANO_PORTC_MAP, COMPAT_PD>::span == 0xCF);
+    STATIC_REQUIRE(!compat_port<NANO_PORTC_MAP, COMPAT_PD>::shifted);
+    STATIC_REQUIRE(compat_port<NANO_PORTC_MAP, COMPAT_PA>::span == 0x30);
+    STATIC_REQUIRE(compat_port<NANO_PORTC_MAP, COMPAT_PA>::shift == -2);
+    STATIC_REQUIRE(compat_port<NANO_PORTC_MAP, COMPAT_PA>::shifted);
+    STATIC_REQUIRE(compat_port<NANO_PORTC_MAP, COMPAT_PD>::mask(0xFF) == 0x3F);
+    STATIC_REQUIRE(compat_port<NANO_PORTC_MAP, COMPAT_PD>::mask(1<<7) == (1<<5));
+    STATIC_REQUIRE(compat_port<NANO_PORTC_MAP, COMPAT_PA>::mask(0xFF) == 0x0C);
+    STATIC_REQUIRE(compat_port<NANO_PORTC_MAP, COMPAT_PA>::gather(0xFF) == 0x30);
+  }
+
+  GIVEN("ATMEGA328P PORTD") {
+    STATIC_REQUIRE(compat_port<NANO_PORTD_MAP, COMPAT_PC>::span == 0x13);
+    STATIC_REQUIRE(!compat_port<NANO_PORTD_MAP, COMPAT_PC>::shifted);
+    STATIC_REQUIRE(compat_port<NANO_PORTD_MAP, COMPAT_PA>::span == 0x84);
+    STATIC_REQUIRE(!compat_port<NANO_PORTD_MAP, COMPAT_PA>::shifted);
+    STATIC_REQUIRE(compat_port<NANO_PORTD_MAP, COMPAT_PF>::span == 0x48);
+    STATIC_REQUIRE(!compat_port<NANO_PORTD_MAP, COMPAT_PF>::shifted);
+    STATIC_REQUIRE(compat_port<NANO_PORTD_MAP, COMPAT_PB>::span == 0x20);
+    STATIC_REQUIRE(compat_port<NANO_PORTD_MAP, COMPAT_PB>::shift == -3);
+    STATIC_REQUIRE(compat_port<NANO_PORTD_MAP, COMPAT_PB>::shifted);
+    STATIC_REQUIRE(compat_port<NANO_PORTD_MAP, COMPAT_PC>::mask(0xFF) == 0x70);
+    STATIC_REQUIRE(compat_port<NANO_PORTD_MAP, COMPAT_PA>::mask(0xFF) == 0x03);
+    STATIC_REQUIRE(compat_port<NANO_PORTD_MAP, COMPAT_PF>::mask(1<<3) == (1<<5));
+    STATIC_REQUIRE(compat_port<NANO_PORTD_MAP, COMPAT_PB>::mask(0xFF) == (1<<2));
+  }
+
+  GIVEN("Every value") {
+    /* mask() and gather() undo each other over the wired bits */
+    for (int v = 0; v < 256; v++) {
+      uint8_t const back = compat_port<NANO_PORTD_MAP, COMPAT_PC>::gather(compat_port<NANO_PORTD_MAP, COMPAT_PC>::mask(v)) |
+                           compat_port<NANO_PORTD_MAP, COMPAT_PA>::gather(compat_port<NANO_PORTD_MAP, COMPAT_PA>::mask(v)) |
+                           compat_port<NANO_PORTD_MAP, COMPAT_PF>::gather(compat_port<NANO_PORTD_MAP, COMPAT_PF>::mask(v)) |
+                           compat_port<NANO_PORTD_MAP, COMPAT_PB>::gather(compat_port<NANO_PORTD_MAP, COMPAT_PB>::mask(v));
+      REQUIRE(back == v);
+    }
+  }
+}
+
+/*****************************************************************************/
+
+/* Bit rates in the SoftwareSerial delay table, at the clocks of the boards */
+static uint32_t const SS_SPEEDS[] = { 57600, 38400, 31250, 28800, 19200, 14400, 9600, 4800, 2400, 1200, 600, 300 };
+static uint32_t const SS_CLOCKS[] = { 16000000, 20000000 };
+
+/* Worst distance of the receive samples from the bit centers over a 9-bit
+ * frame with parity, in bits, when each loop pass takes extra cycles
+ * more than the model says */
+static double ss_rx_error(uint32_t f_cpu, uint32_t speed, int extra)
+{
+  double const bit = (double)f_cpu / speed;
+  long const start = _SS_RX_START_CYCLES + 4L * _ss_delay(f_cpu * 3 / 2, speed, _SS_RX_START_CYCLES);
+  long const pass = _SS_RX_BIT_CYCLES + extra + 4L * _ss_delay(f_cpu, speed, _SS_RX_BIT_CYCLES);
+  double worst = 0;
+  for (int k = 0; k < 10; k++)
+    worst = std::max(worst, std::abs(start + k * pass - (1.5 + k) * bit) / bit);
+  return worst;
+}
+
+/* Worst distance of the transmitted edges from where they belong over the
+ * start, data, parity and two stop bits, in bits */
+static double ss_tx_error(uint32_t f_cpu, uint32_t speed, int extra)
+{
+  double const bit = (double)f_cpu / speed;
+  long const pass = _SS_TX_BIT_CYCLES + extra + 4L * _ss_delay(f_cpu, speed, _SS_TX_BIT_CYCLES);
+  double worst = 0;
+  for (int k = 1; k <= 12; k++)
+    worst = std::max(worst, std::abs(k * (pass - bit)) / bit);
+  return worst;
+}
+
+SCENARIO("Testing the SoftwareSerial delays against the cycle model", "SoftwareSerialTiming::_ss_delay") {
+  GIVEN("Delays that fit in the bit time") {
+    /* overhead plus 4 cycles per count lands within 2 cycles of the target */
+    for (uint32_t f_cpu : SS_CLOCKS) {
+      for (uint32_t speed : SS_SPEEDS) {
+        uint32_t const delay = _ss_delay(f_cpu, speed, _SS_TX_BIT_CYCLES);
+        REQUIRE(std::abs((double)(_SS_TX_BIT_CYCLES + 4 * delay) - (double)f_cpu / speed) <= 2.0);
+      }
+    }
+  }
+
+  GIVEN("An overhead longer than the bit time") {
+    STATIC_REQUIRE(_ss_delay(16000000, 1000000, 20) == 1);
+    STATIC_REQUIRE(_ss_delay(16000000, 1000000, 16) == 1);
+  }
+
+  GIVEN("Cycle counts that match the model") {
+    /* samples and edges stay within a tenth of a bit at every table rate */
+    for (uint32_t f_cpu : SS_CLOCKS) {
+      for (uint32_t speed : SS_SPEEDS) {
+        INFO("F_CPU " << f_cpu << ", " << speed << " baud");
+        REQUIRE(ss_rx_error(f_cpu, speed, 0) <= 0.10);
+        REQUIRE(ss_tx_error(f_cpu, speed, 0) <= 0.10);
+      }
+    }
+  }
+
+  GIVEN("Loops that take 4 cycles per bit more or less than the model") {
+    /* the samples stay in the middle half of each bit */
+    for (uint32_t f_cpu : SS_CLOCKS) {
+      for (uint32_t speed : SS_SPEEDS) {
+        INFO("F_CPU " << f_cpu << ", " << speed << " baud");
+        REQUIRE(ss_rx_error(f_cpu, speed, 4) <= 0.25);
+        REQUIRE(ss_rx_error(f_cpu, speed, -4) <= 0.25);
+        REQUIRE(ss_tx_error(f_cpu, speed, 4) <= 0.25);
+        REQUIRE(ss_tx_error(f_cpu, speed, -4) <= 0.25);
+      }
+    }
+  }
+}
+
+SCENARIO("Testing the SoftwareSerial loop measurement", "SoftwareSerialTiming::_ss_loop_cycles") {
+  GIVEN("Loops of 8 to 60 cycles per bit, timed from any TCA0 phase") {
+    /* 16 calls for 1 bit and 16 calls for 16 bits, each bit with a delay
+     * of 4 cycles, and 20 cycles to call and return */
+    for (long cycles = 8; cycles <= 60; cycles++) {
+      for (long phase = 0; phase < 64; phase += 7) {
+        long const pass = cycles + 4;
+        long const t_short = 16 * (20 + pass);
+        long const t_long = 16 * (20 + 16 * pass);
+        uint16_t const ticks_short = (phase + t_short) / 64 - phase / 64;
+        uint16_t const ticks_long = (phase + t_long) / 64 - phase / 64;
+        INFO(cycles << " cycles, phase " << phase);
+        REQUIRE(std::abs(_ss_loop_cycles(ticks_long, ticks_short) - cycles) <= 1);
+      }
+    }
+  }
+}
@@ -26,7 +26,7 @@ uint8_t eeprom_pagesize;
 
 // *** Local functions declaration ***
 void NVM_fuse_write (uint16_t address, uint8_t data);
-void NVM_buffered_write(uint16_t address, uint16_t lenght, uint8_t buff_size, uint8_t write_type);
+bool NVM_buffered_write(uint16_t address, uint16_t lenght, uint8_t buff_size, uint8_t write_type);
 }
 
 // *** Packet functions ***
@@ -96,7 +96,7 @@ void JTAG2::sign_on() {
   /* Initialize or enable UPDI */
   UPDI_io::put(UPDI_io::double_break);
   UPDI::stcs(UPDI::reg::Control_B, 8);
-  UPDI::stcs(UPDI::reg::Control_A, 0x80);
+  UPDI::stcs(UPDI::reg::Control_A, UPDI::IBDLY);
   // Send sign on message
   packet.size_word[0] = sizeof(sgn_resp);
   for (uint8_t i = 0; i < sizeof(sgn_resp); i++) {
@@ -229,16 +229,16 @@ void JTAG2::read_mem() {
   else {
     // in program mode
     const uint16_t NumBytes = (packet.body[3] << 8) | packet.body[2];
+    if (NumBytes == 0 || NumBytes >= MAX_BODY_SIZE) {
+      set_status(RSP_ILLEGAL_MEMORY_RANGE);
+      return;
+    }
     // Get physical address for reading
     const uint16_t address = (packet.body[7] << 8) | packet.body[6];
     // Set UPDI pointer to address
     UPDI::stptr_w(address);
     // Read block
-    UPDI::rep(NumBytes - 1);
-    packet.body[1] = UPDI::ldinc_b();
-    for (uint16_t i = 2; i <= NumBytes; i++) {
-      packet.body[i] = UPDI_io::get();
-    }
+    UPDI::ldinc_block(&packet.body[1], NumBytes);
     packet.size_word[0] = NumBytes + 1;
     packet.body[0] = RSP_MEMORY;
   }
@@ -268,7 +268,10 @@ void JTAG2::write_mem() {
       case MTYPE_BOOT_FLASH:
       case MTYPE_EEPROM_XMEGA:
       case MTYPE_USERSIG:
-        NVM_buffered_write(address, lenght, buff_size, write_cmnd);
+        if (!NVM_buffered_write(address, lenght, buff_size, write_cmnd)) {
+          set_status(RSP_FAILED);
+          return;
+        }
         break;
       default:
         set_status(RSP_ILLEGAL_MEMORY_TYPE);
@@ -320,24 +323,21 @@ void NVM_fuse_write (uint16_t address, uint8_t data) {
   NVM::command<false>(NVM::WFU);
 }
 
-void NVM_buffered_write(const uint16_t address, const uint16_t length, const uint8_t buff_size, const uint8_t write_cmnd) {
-  uint8_t current_byte_index = 10;					/* Index of the first byte to send inside the JTAG2 command body */
+// Returns false if a block was not sent in full, leaving the rest unwritten
+bool NVM_buffered_write(const uint16_t address, const uint16_t length, const uint8_t buff_size, const uint8_t write_cmnd) {
+  uint16_t current_byte_index = 10;					/* Index of the first byte to send inside the JTAG2 command body */
   uint16_t bytes_remaining = length;					/* number of bytes to write */
 
   // Sends a block of bytes from the command body to memory, using the UPDI interface
   // On entry, the UPDI pointer must already point to the desired address
   // On exit, the UPDI pointer points to the next byte after the last one written
-  // Returns updated index into the command body, pointing to the first unsent byte.
-  auto updi_send_block = [] (uint8_t count, uint8_t index) {
-    count--;
+  // Updates the index into the command body to point to the first unsent byte.
+  // Returns false if the block did not go out in full.
+  auto updi_send_block = [] (uint8_t count, uint16_t & index) {
     NVM::wait<true>();
-    UPDI::rep(count);
-    UPDI::stinc_b(JTAG2::packet.body[index]);
-    for (uint8_t i = count; i; i--) {
-      UPDI_io::put(JTAG2::packet.body[++index]);
-      UPDI_io::get();
-    }
-    return ++index;
+    const bool sent = UPDI::stinc_block(&JTAG2::packet.body[index], count);
+    index += count;
+    return sent;
   };
 
   // Setup UPDI pointer for block transfer
@@ -348,22 +348,23 @@ void NVM_buffered_write(const uint16_t address, const uint16_t length, const uin
   /* If there are unaligned bytes, they must be sent first */
   if (unaligned_bytes) {
     // Send unaligned block
-    current_byte_index = updi_send_block(unaligned_bytes, current_byte_index);
+    if (!updi_send_block(unaligned_bytes, current_byte_index)) return false;
     bytes_remaining -= unaligned_bytes;
     NVM::command<true>(write_cmnd);
   }
   while (bytes_remaining) {
     /* Send a buff_size amount of bytes */
     if (bytes_remaining >= buff_size) {
-      current_byte_index = updi_send_block(buff_size, current_byte_index);
+      if (!updi_send_block(buff_size, current_byte_index)) return false;
       bytes_remaining -= buff_size;
     }
     /* Send a NumBytes amount of bytes */
     else {
-      current_byte_index = updi_send_block(bytes_remaining, current_byte_index);
+      if (!updi_send_block(bytes_remaining, current_byte_index)) return false;
       bytes_remaining = 0;
     }
     NVM::command<true>(write_cmnd);
   }
+  return true;
 }
 }
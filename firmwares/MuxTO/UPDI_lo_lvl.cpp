@@ -219,3 +219,40 @@ void UPDI::stinc_w(uint16_t data) {
   UPDI_io::put(data >> 8);
   UPDI_io::get();
 }
+
+/* Stores count bytes with a single REPEAT of word ST *(ptr++). The ACKs are
+   turned off meanwhile, so that the data goes out as one stream. Returns
+   false if the stream was not echoed back in full */
+bool UPDI::stinc_block(const uint8_t * data, uint16_t count) {
+  const uint16_t words = count >> 1;
+  bool sent = true;
+  if (words) {
+    UPDI::stcs(UPDI::reg::Control_A, UPDI::IBDLY | UPDI::RSD);
+    UPDI::rep(words - 1);
+    UPDI_io::put(UPDI::SYNCH);
+    UPDI_io::put(0x65);
+    sent = UPDI_io::put(data, words * 2);
+    UPDI::stcs(UPDI::reg::Control_A, UPDI::IBDLY);
+    data += words * 2;
+  }
+  if (count & 1) {
+    UPDI::stinc_b(*data);
+  }
+  return sent;
+}
+
+/* Loads count bytes with a single REPEAT of word LD *(ptr++) */
+void UPDI::ldinc_block(uint8_t * data, uint16_t count) {
+  const uint16_t words = count >> 1;
+  if (words) {
+    UPDI::rep(words - 1);
+    UPDI_io::put(UPDI::SYNCH);
+    UPDI_io::put(0x25);
+    for (uint16_t i = words * 2; i; i--) {
+      *data++ = UPDI_io::get();
+    }
+  }
+  if (count & 1) {
+    *data = UPDI::ldinc_b();
+  }
+}
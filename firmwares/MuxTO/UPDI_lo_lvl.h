@@ -27,6 +27,10 @@ enum reg {
 constexpr uint8_t SYNCH = 0x55;
 constexpr uint8_t ACK = 0x40;
 
+// Control_A bits
+constexpr uint8_t IBDLY = 0x80;   /* Inter-byte delay enable */
+constexpr uint8_t RSD = 0x08;     /* Response signature (ACK) disable */
+
 // Activation Keys
 extern uint8_t Chip_Erase[8];
 extern uint8_t NVM_Prog[8];
@@ -61,6 +65,10 @@ void st_w(uint16_t);
 void stinc_b(uint8_t);
 void stinc_w(uint16_t);
 
+// Block transfers from the UPDI pointer on, up to 512 bytes
+bool stinc_block(const uint8_t *, uint16_t);
+void ldinc_block(uint8_t *, uint16_t);
+
 template <class T>
 inline void write_key(T (& k)[8]) __attribute__(( optimize("no-tree-loop-optimize") ));
 
@@ -14,7 +14,7 @@
 /* Sends regular characters through the UPDI link */
 uint8_t UPDI_io::put(char c) {
   Serial2.write(c);
-  Serial2.flush();
+  // No need to flush, the echo only comes back once the character is sent
   //delayMicroseconds(10);
   long start = millis();
   while (!Serial2.available() && millis() - start < 20) {}
@@ -25,6 +25,30 @@ uint8_t UPDI_io::put(char c) {
   return c;
 }
 
+/* Sends a block of characters through the UPDI link without waiting for
+   each echo. The transmitter is kept busy, and the echoes are discarded
+   as they come in so that the receive buffer cannot overflow. Returns
+   false if some echoes did not come back, the link having failed */
+bool UPDI_io::put(const uint8_t * data, uint16_t count) {
+  uint16_t pending = 0;
+  while (count--) {
+    Serial2.write(*data++);
+    pending++;
+    while (Serial2.available()) {
+      Serial2.read();
+      pending--;
+    }
+  }
+  long start = millis();
+  while (pending && millis() - start < 20) {
+    if (Serial2.available()) {
+      Serial2.read();
+      pending--;
+    }
+  }
+  return !pending;
+}
+
 /* Sends special sequences through the UPDI link */
 uint8_t UPDI_io::put(ctrl c)
 {
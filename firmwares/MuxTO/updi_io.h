@@ -16,6 +16,7 @@ enum ctrl {single_break, double_break, enable};
 // Function prototypes
 uint8_t put(char) __attribute__((optimize("no-tree-loop-optimize")));
 uint8_t put(ctrl);
+bool put(const uint8_t *, uint16_t);
 uint8_t get() __attribute__((optimize("no-tree-loop-optimize")));
 void init(void);
 }
@@ -220,6 +220,16 @@ static inline void send_break() {
   return;
 }
 
+/* Sends a block of characters through the UPDI link */
+bool UPDI_io::put(const uint8_t * data, uint16_t count) {
+
+  // No echo to wait for, the bits are sent one character after the other
+  while (count--) {
+    put((char)*data++);
+  }
+  return true;
+}
+
 /* Sends special sequences through the UPDI link */
 uint8_t UPDI_io::put(ctrl c) {
 
@@ -0,0 +1,52 @@
+/***
+    eeprom_store example.
+
+    This shows how to use the EEPROMStore class to keep values
+    that change often, here a boot counter and a run time in
+    minutes, without wearing out the EEPROM.
+
+    Each update is appended to a log that spreads the writes
+    over the whole EEPROM, so the cells last far longer than
+    with EEPROM.put() to a fixed address. Pressing reset in
+    the middle of an update leaves the old value in place.
+
+    Released under MIT licence.
+***/
+
+#include <EEPROMStore.h>
+
+enum { KEY_BOOTS, KEY_MINUTES };
+
+EEPROMStore store;
+uint32_t minutes = 0;
+
+void setup() {
+
+  Serial.begin(9600);
+  while (!Serial) {
+    ; // wait for serial port to connect. Needed for native USB port only
+  }
+
+  store.begin();
+
+  uint16_t boots = 0;
+  store.get(KEY_BOOTS, boots);   //Leaves boots unchanged if it was never stored.
+  store.get(KEY_MINUTES, minutes);
+
+  ++boots;
+  store.put(KEY_BOOTS, boots);
+
+  Serial.print("Boot number ");
+  Serial.print(boots);
+  Serial.print(", run time so far ");
+  Serial.print(minutes);
+  Serial.println(" minutes");
+}
+
+void loop() {
+  delay(60000);
+  ++minutes;
+  if (!store.put(KEY_MINUTES, minutes)) {
+    Serial.println("Store is full!");
+  }
+}
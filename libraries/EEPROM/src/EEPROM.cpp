@@ -0,0 +1,60 @@
+/*
+  EEPROM.cpp - EEPROM library, page writes
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "EEPROM.h"
+
+//Indices of the asynchronous write queue in EEPROMQueue.cpp. They stay equal,
+//the queue empty, unless it is used.
+volatile uint8_t eeprom_queue_head = 0;
+volatile uint8_t eeprom_queue_tail = 0;
+
+//Disable interrupts once the EEPROM is ready, returning the old SREG.
+static uint8_t eeprom_ready_cli(){
+    uint8_t oldSREG = SREG;
+    for( ;; ){
+        cli();
+        if( !( NVMCTRL.STATUS & NVMCTRL_EEBUSY_bm ) ) return oldSREG;
+        SREG = oldSREG;
+    }
+}
+
+//Load the changed bytes of one page into the NVM page buffer, then erase and write them in one go.
+//The buffer is written through the memory mapped EEPROM; only loaded bytes are programmed.
+void eeprom_page_write( int idx, const uint8_t *src, uint8_t n ){
+    volatile uint8_t *ee = (volatile uint8_t*) ( MAPPED_EEPROM_START + idx );
+    bool dirty = false;
+    //An interrupt writing EEPROM or flash must not touch the page buffer in between.
+    uint8_t oldSREG = eeprom_ready_cli();
+    for( uint8_t i = 0 ; i < n ; ++i ){
+        if( ee[i] != src[i] ){
+            ee[i] = src[i];
+            dirty = true;
+        }
+    }
+    if( dirty ) _PROTECTED_WRITE_SPM( NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc );
+    SREG = oldSREG;
+}
+
+//Stand-ins for the queue functions, replaced by those of EEPROMQueue.cpp when
+//putAsync() or writeBlockAsync() link it in. Otherwise the queue is always
+//empty, and neither its buffers nor its interrupt are part of the sketch.
+__attribute__(( weak )) uint8_t eeprom_queue_read( int idx ){
+    return *eeprom_mapped( idx );
+}
+
+__attribute__(( weak )) void eeprom_queue_flush(){}
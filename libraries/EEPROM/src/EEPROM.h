@@ -24,6 +24,36 @@
 #include <inttypes.h>
 #include <avr/eeprom.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
+
+#ifndef EEPROM_QUEUE_SIZE
+#define EEPROM_QUEUE_SIZE 64 //Bytes that can wait for an asynchronous write.
+#endif
+
+/***
+    Page writes, see EEPROM.cpp, and the asynchronous write queue, see EEPROMQueue.cpp.
+    
+    Queued bytes are programmed a page at a time from the NVMCTRL EEPROM ready
+    interrupt. Until a byte has been programmed, reads of its cell return the
+    queued value. Writes that do not go through the queue wait for it to drain
+    first, so writes always land in program order. The queue is only linked in
+    by putAsync() and writeBlockAsync(); the library is built as an archive for
+    this, see library.properties.
+***/
+
+extern volatile uint8_t eeprom_queue_head;
+extern volatile uint8_t eeprom_queue_tail;
+
+void eeprom_page_write( int idx, const uint8_t *src, uint8_t n );
+uint8_t eeprom_queue_read( int idx );
+void eeprom_queue_write( int idx, const uint8_t *src, uint16_t len );
+void eeprom_queue_flush();
+
+inline bool eeprom_queue_busy()          { return eeprom_queue_head != eeprom_queue_tail; }
+
+//The EEPROM is mapped into the data space, so cells are read with ordinary loads.
+//The CPU is halted on a read while a write is in progress, so no busy check is needed.
+inline const volatile uint8_t *eeprom_mapped( int idx ) { return (const volatile uint8_t*) ( MAPPED_EEPROM_START + idx ); }
 
 /***
     EERef class.
@@ -39,12 +69,12 @@ struct EERef{
         : index( index )                 {}
     
     //Access/read members.
-    uint8_t operator*() const            { return eeprom_read_byte( (uint8_t*) index ); }
+    uint8_t operator*() const            { return eeprom_queue_busy() ? eeprom_queue_read( index ) : *eeprom_mapped( index ); }
     operator uint8_t() const             { return **this; }
     
     //Assignment/write members.
     EERef &operator=( const EERef &ref ) { return *this = *ref; }
-    EERef &operator=( uint8_t in )       { return eeprom_write_byte( (uint8_t*) index, in ), *this;  }
+    EERef &operator=( uint8_t in )       { return eeprom_queue_flush(), eeprom_write_byte( (uint8_t*) index, in ), *this;  }
     EERef &operator +=( uint8_t in )     { return *this = **this + in; }
     EERef &operator -=( uint8_t in )     { return *this = **this - in; }
     EERef &operator *=( uint8_t in )     { return *this = **this * in; }
@@ -128,18 +158,59 @@ struct EEPROMClass{
     
     //Functionality to 'get' and 'put' objects to and from EEPROM.
     template< typename T > T &get( int idx, T &t ){
-        EEPtr e = idx;
         uint8_t *ptr = (uint8_t*) &t;
-        for( int count = sizeof(T) ; count ; --count, ++e )  *ptr++ = *e;
+        if( eeprom_queue_busy() ){
+            EEPtr e = idx;
+            for( int count = sizeof(T) ; count ; --count, ++e )  *ptr++ = *e;
+        }else{
+            const volatile uint8_t *ee = eeprom_mapped( idx );
+            for( int count = sizeof(T) ; count ; --count )  *ptr++ = *ee++;
+        }
         return t;
     }
     
+    //Read an object in place, without copying it out of the memory mapped EEPROM.
+    //Pending asynchronous writes are completed first so the object is up to date.
+    //The pointer stays valid, but the object changes with any later write to its cells.
+    template< typename T > const T *view( int idx ){
+        eeprom_queue_flush();
+        return (const T*) eeprom_mapped( idx );
+    }
+    
     template< typename T > const T &put( int idx, const T &t ){
-        EEPtr e = idx;
-        const uint8_t *ptr = (const uint8_t*) &t;
-        for( int count = sizeof(T) ; count ; --count, ++e )  (*e).update( *ptr++ );
+        writeBlock( idx, &t, sizeof(T) );
+        return t;
+    }
+    
+    //Write a block of bytes, updating only the bytes that differ.
+    //Each EEPROM page touched costs a single erase/write cycle rather than one per byte.
+    void writeBlock( int idx, const void *src, uint16_t len ){
+        const uint8_t *ptr = (const uint8_t*) src;
+        eeprom_queue_flush();
+        while( len ){
+            uint16_t n = EEPROM_PAGE_SIZE - ( idx & ( EEPROM_PAGE_SIZE - 1 ) );
+            if( n > len ) n = len;
+            eeprom_page_write( idx, ptr, n );
+            idx += n;
+            ptr += n;
+            len -= n;
+        }
+    }
+    
+    //Asynchronous versions of put() and writeBlock(). These queue the bytes and return
+    //without waiting for the EEPROM, unless the queue is full.
+    template< typename T > const T &putAsync( int idx, const T &t ){
+        writeBlockAsync( idx, &t, sizeof(T) );
         return t;
     }
+    
+    void writeBlockAsync( int idx, const void *src, uint16_t len ) { eeprom_queue_write( idx, (const uint8_t*) src, len ); }
+    
+    //True while queued writes have not all been programmed.
+    bool writing()                       { return eeprom_queue_busy(); }
+    
+    //Wait for all queued writes to be programmed.
+    void flush()                         { eeprom_queue_flush(); }
 };
 
 static EEPROMClass EEPROM;
@@ -0,0 +1,125 @@
+/*
+  EEPROMQueue.cpp - EEPROM library, asynchronous write queue
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "EEPROM.h"
+
+/***
+    Write queue.
+    
+    A ring buffer of cell index and value pairs, oldest at the head. The entries
+    of the page being programmed stay in the queue until the programming is
+    done, so reads of those cells are still served from the queue.
+***/
+
+static volatile uint16_t queue_index[ EEPROM_QUEUE_SIZE ];
+static volatile uint8_t queue_data[ EEPROM_QUEUE_SIZE ];
+static volatile uint8_t queue_inflight = 0; //Entries at the head being programmed.
+
+//Retire the entries just programmed and start on the next page.
+//Called with interrupts disabled while the EEPROM is ready.
+static void eeprom_queue_service(){
+    uint8_t head = ( eeprom_queue_head + queue_inflight ) % EEPROM_QUEUE_SIZE;
+    eeprom_queue_head = head;
+    queue_inflight = 0;
+    
+    while( head != eeprom_queue_tail ){
+        //Take the run of entries at the head that fall in the same page. A cell
+        //written twice ends the run, as the page buffer can only be loaded once.
+        uint16_t page = queue_index[ head ] & ~( EEPROM_PAGE_SIZE - 1 );
+        uint8_t loaded[ EEPROM_PAGE_SIZE / 8 ] = { 0 };
+        bool dirty = false;
+        uint8_t n = 0;
+        for( uint8_t i = head ; i != eeprom_queue_tail ; i = ( i + 1 ) % EEPROM_QUEUE_SIZE, ++n ){
+            uint16_t idx = queue_index[ i ];
+            uint8_t *mask = &loaded[ ( idx & ( EEPROM_PAGE_SIZE - 1 ) ) >> 3 ];
+            uint8_t bit = 1 << ( idx & 7 );
+            if( ( idx & ~( EEPROM_PAGE_SIZE - 1 ) ) != page || ( *mask & bit ) ) break;
+            *mask |= bit;
+            volatile uint8_t *ee = (volatile uint8_t*) ( MAPPED_EEPROM_START + idx );
+            if( *ee != queue_data[ i ] ){
+                *ee = queue_data[ i ];
+                dirty = true;
+            }
+        }
+        
+        if( dirty ){
+            _PROTECTED_WRITE_SPM( NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc );
+            NVMCTRL.INTFLAGS = NVMCTRL_EEREADY_bm;
+            NVMCTRL.INTCTRL = NVMCTRL_EEREADY_bm;
+            queue_inflight = n;
+            return;
+        }
+        
+        //Nothing to change in this run.
+        head = ( head + n ) % EEPROM_QUEUE_SIZE;
+        eeprom_queue_head = head;
+    }
+    
+    //The ready flag stays set while the EEPROM is idle, so stop the interrupt.
+    NVMCTRL.INTCTRL = 0;
+}
+
+ISR( NVMCTRL_EE_vect ){
+    eeprom_queue_service();
+}
+
+//Run the queue from here if the interrupt cannot, as when interrupts are disabled.
+static void eeprom_queue_poll(){
+    uint8_t oldSREG = SREG;
+    cli();
+    if( ( NVMCTRL.INTCTRL & NVMCTRL_EEREADY_bm ) && !( NVMCTRL.STATUS & NVMCTRL_EEBUSY_bm ) ) eeprom_queue_service();
+    SREG = oldSREG;
+}
+
+uint8_t eeprom_queue_read( int idx ){
+    uint8_t oldSREG = SREG;
+    cli();
+    //Newest entry for the cell wins.
+    for( uint8_t i = eeprom_queue_tail ; i != eeprom_queue_head ; ){
+        i = ( i + EEPROM_QUEUE_SIZE - 1 ) % EEPROM_QUEUE_SIZE;
+        if( queue_index[ i ] == idx ){
+            uint8_t val = queue_data[ i ];
+            SREG = oldSREG;
+            return val;
+        }
+    }
+    SREG = oldSREG;
+    return *eeprom_mapped( idx );
+}
+
+void eeprom_queue_write( int idx, const uint8_t *src, uint16_t len ){
+    while( len-- ){
+        uint8_t next = ( eeprom_queue_tail + 1 ) % EEPROM_QUEUE_SIZE;
+        while( next == eeprom_queue_head ) eeprom_queue_poll();
+        
+        queue_index[ eeprom_queue_tail ] = idx++;
+        queue_data[ eeprom_queue_tail ] = *src++;
+        
+        uint8_t oldSREG = SREG;
+        cli();
+        eeprom_queue_tail = next;
+        //Start the queue if idle. The interrupt fires at once if the EEPROM is ready.
+        if( !queue_inflight ) NVMCTRL.INTCTRL = NVMCTRL_EEREADY_bm;
+        SREG = oldSREG;
+    }
+}
+
+void eeprom_queue_flush(){
+    while( eeprom_queue_head != eeprom_queue_tail ) eeprom_queue_poll();
+}
+
@@ -0,0 +1,192 @@
+/*
+  EEPROMStore.cpp - Wear leveling key/value store on top of the EEPROM library
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+#include <util/crc16.h>
+#include "EEPROMStore.h"
+
+//Sequence numbers wrap; only a small window of them is ever in the log.
+static inline bool newer( uint16_t a, uint16_t b ){
+    return (int16_t) ( a - b ) > 0;
+}
+
+//Size of the valid record at off, or 0 if it is not a valid record ending before end.
+uint8_t EEPROMStore::check( uint16_t off, uint16_t end ){
+    uint8_t key = read( off );
+    uint8_t len = length( off );
+    if( key >= EEPROM_STORE_KEYS || len > EEPROM_STORE_VALUE_MAX ) return 0;
+    uint8_t n = len + EEPROM_STORE_OVERHEAD;
+    if( off + n > end ) return 0;
+
+    uint16_t crc = 0xFFFF;
+    for( uint8_t i = 0 ; i < n - 2 ; ++i ) crc = _crc_ccitt_update( crc, read( off + i ) );
+    if( crc != ( read( off + n - 2 ) | ( read( off + n - 1 ) << 8 ) ) ) return 0;
+    return n;
+}
+
+//Fill in the sequence number and CRC of a record in RAM.
+void EEPROMStore::seal( uint8_t *rec, uint16_t seq ){
+    uint8_t n = rec[1] + EEPROM_STORE_OVERHEAD;
+    rec[2] = seq;
+    rec[3] = seq >> 8;
+
+    uint16_t crc = 0xFFFF;
+    for( uint8_t i = 0 ; i < n - 2 ; ++i ) crc = _crc_ccitt_update( crc, rec[i] );
+    rec[n - 2] = crc;
+    rec[n - 1] = crc >> 8;
+}
+
+void EEPROMStore::begin(){
+    bool found = false;
+    memset( _index, NONE, sizeof(_index) );
+    _head = _pages - 1; //An empty log starts on the first page.
+    _fill = EEPROM_PAGE_SIZE;
+    _seq = 0;
+
+    for( uint8_t page = 0 ; page < _pages ; ++page ){
+        uint16_t off = page * EEPROM_PAGE_SIZE;
+        uint16_t end = off + EEPROM_PAGE_SIZE;
+        bool head = false;
+
+        while( off < end && read( off ) != 0xFF ){
+            uint8_t n = check( off, end );
+            if( !n ){
+                off = end; //Cut short or foreign data; nothing more is appended to this page.
+                break;
+            }
+            uint8_t key = read( off );
+            uint16_t seq = sequence( off );
+            if( _index[ key ] == NONE || newer( seq, sequence( _index[ key ] ) ) ) _index[ key ] = off;
+            if( !found || newer( seq, _seq ) ){
+                _seq = seq;
+                found = head = true;
+            }
+            off += n;
+        }
+
+        if( head ){
+            _head = page;
+            _fill = off - page * EEPROM_PAGE_SIZE;
+        }
+    }
+
+    //The page after the newest one only holds live records if a reset cut short
+    //writing the newest page. Write it again to finish moving them.
+    if( found ){
+        for( uint8_t k = 0 ; k < EEPROM_STORE_KEYS ; ++k ){
+            if( holds( next( _head ), _index[ k ] ) ){
+                rewrite( _head, 0, 0 );
+                break;
+            }
+        }
+    }
+}
+
+uint8_t EEPROMStore::get( uint8_t key, void *dst, uint8_t len ){
+    if( key >= EEPROM_STORE_KEYS || _index[ key ] == NONE ) return 0;
+    uint8_t off = _index[ key ];
+    uint8_t n = length( off );
+    uint8_t *ptr = (uint8_t*) dst;
+    for( uint8_t i = 0 ; i < n && i < len ; ++i ) *ptr++ = read( off + 4 + i );
+    return n;
+}
+
+bool EEPROMStore::put( uint8_t key, const void *src, uint8_t len ){
+    if( key >= EEPROM_STORE_KEYS || len > EEPROM_STORE_VALUE_MAX ) return false;
+
+    uint16_t live = len + EEPROM_STORE_OVERHEAD;
+    for( uint8_t k = 0 ; k < EEPROM_STORE_KEYS ; ++k ){
+        if( k != key && _index[ k ] != NONE ) live += length( _index[ k ] ) + EEPROM_STORE_OVERHEAD;
+    }
+    if( live > capacity() ) return false;
+
+    uint8_t rec[ RECORD_MAX ];
+    uint8_t n = len + EEPROM_STORE_OVERHEAD;
+    rec[0] = key;
+    rec[1] = len;
+    if( len ) memcpy( rec + 4, src, len );
+
+    //Append to the head page if there is room.
+    if( _fill + n <= EEPROM_PAGE_SIZE ){
+        uint8_t off = _head * EEPROM_PAGE_SIZE + _fill;
+        seal( rec, ++_seq );
+        EEPROM.writeBlock( _base + off, rec, n );
+        _index[ key ] = off;
+        _fill += n;
+        return true;
+    }
+
+    //Move on to the next page. The capacity check ensures that this finds room
+    //within one turn of the ring.
+    for( uint8_t tries = 0 ; tries < _pages ; ++tries ){
+        if( rewrite( next( _head ), rec, n ) ) return true;
+    }
+    return false;
+}
+
+//Write a page in one go, erasing what was there. The page gets the live records it
+//holds itself and those of the page after it, then the record rec if there is room,
+//which then replaces the record of its key instead of a copy of it. Returns true if
+//rec was placed. If the live records do not fit, nothing is written rather than
+//losing any of them, and false is returned.
+bool EEPROMStore::rewrite( uint8_t page, const uint8_t *rec, uint8_t n ){
+    uint16_t live = 0;
+    uint8_t replaced = 0;
+    for( uint8_t k = 0 ; k < EEPROM_STORE_KEYS ; ++k ){
+        if( !holds( page, _index[ k ] ) && !holds( next( page ), _index[ k ] ) ) continue;
+        uint8_t m = length( _index[ k ] ) + EEPROM_STORE_OVERHEAD;
+        if( n && k == rec[0] ) replaced = m;
+        else live += m;
+    }
+    bool placed = n && live + n <= EEPROM_PAGE_SIZE;
+    if( !placed && live + replaced > EEPROM_PAGE_SIZE ) return false;
+
+    uint8_t buf[ EEPROM_PAGE_SIZE ];
+    uint8_t moved[ EEPROM_STORE_KEYS ];
+    uint8_t fill = 0;
+    memset( buf, 0xFF, sizeof(buf) );
+    memset( moved, NONE, sizeof(moved) );
+
+    for( uint8_t from = page, pass = 0 ; pass < 2 ; from = next( from ), ++pass ){
+        for( uint8_t k = 0 ; k < EEPROM_STORE_KEYS ; ++k ){
+            uint8_t off = _index[ k ];
+            if( !holds( from, off ) || ( placed && k == rec[0] ) ) continue;
+            uint8_t m = length( off ) + EEPROM_STORE_OVERHEAD;
+            for( uint8_t i = 0 ; i < m ; ++i ) buf[ fill + i ] = read( off + i );
+            seal( buf + fill, ++_seq );
+            moved[ k ] = fill;
+            fill += m;
+        }
+    }
+
+    if( placed ){
+        memcpy( buf + fill, rec, n );
+        seal( buf + fill, ++_seq );
+        moved[ rec[0] ] = fill;
+        fill += n;
+    }
+
+    EEPROM.writeBlock( _base + page * EEPROM_PAGE_SIZE, buf, EEPROM_PAGE_SIZE );
+
+    for( uint8_t k = 0 ; k < EEPROM_STORE_KEYS ; ++k ){
+        if( moved[ k ] != NONE ) _index[ k ] = page * EEPROM_PAGE_SIZE + moved[ k ];
+    }
+    _head = page;
+    _fill = fill;
+    return placed;
+}
@@ -0,0 +1,110 @@
+/*
+  EEPROMStore.h - Wear leveling key/value store on top of the EEPROM library
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef EEPROMStore_h
+#define EEPROMStore_h
+
+#include "EEPROM.h"
+
+#ifndef EEPROM_STORE_KEYS
+#define EEPROM_STORE_KEYS 16 //Keys are 0 to EEPROM_STORE_KEYS - 1.
+#endif
+
+#ifndef EEPROM_STORE_VALUE_MAX
+#define EEPROM_STORE_VALUE_MAX 16 //Largest value in bytes.
+#endif
+
+#define EEPROM_STORE_OVERHEAD 6 //Bytes added to each value: key, length, sequence number and CRC.
+
+/***
+    EEPROMStore class.
+
+    A log of records kept in a range of EEPROM pages used as a ring. Every
+    update appends a record holding the key, the value, a sequence number and
+    a CRC, so repeated updates of one key are spread over the whole range.
+    At begin() the log is scanned and the address of the newest valid record
+    of each key is kept in RAM.
+
+    A record that was cut short by a reset fails its CRC and is ignored, so
+    a key keeps either its old or its new value. Before the log moves on to
+    a new page, the live records of the page after it are copied into the
+    new page, and the whole page is written at once. Thus the page after the
+    newest one never holds the only copy of a value, and is free to reuse.
+***/
+
+class EEPROMStore{
+  public:
+    //The store takes pages EEPROM pages, at least two, from firstPage on. A range
+    //that does not fit is clamped: firstPage is lowered to leave two pages, and
+    //pages is raised to two or lowered to the pages left from firstPage on.
+    EEPROMStore( uint8_t firstPage = 0, uint8_t pages = EEPROM_SIZE / EEPROM_PAGE_SIZE )
+        : _base( first( firstPage ) * EEPROM_PAGE_SIZE ), _pages( count( first( firstPage ), pages ) ) {}
+
+    //Scan the log and build the index. Must be called before anything else.
+    void begin();
+
+    //Copy up to len bytes of the value of key to dst. Returns the size of the
+    //value, or 0 if the key has no value.
+    uint8_t get( uint8_t key, void *dst, uint8_t len );
+
+    //Store a new value for key. Returns false if the key or the value is out of
+    //range, or if the values would no longer fit in the log.
+    bool put( uint8_t key, const void *src, uint8_t len );
+
+    bool remove( uint8_t key )           { return put( key, 0, 0 ); }
+    bool contains( uint8_t key )         { return key < EEPROM_STORE_KEYS && _index[ key ] != NONE && length( _index[ key ] ); }
+
+    //Functionality to 'get' and 'put' objects.
+    template< typename T > bool get( uint8_t key, T &t ){
+        return get( key, &t, sizeof(T) ) == sizeof(T);
+    }
+
+    template< typename T > bool put( uint8_t key, const T &t ){
+        return put( key, &t, sizeof(T) );
+    }
+
+    //Bytes of records that can be stored. Each value takes EEPROM_STORE_OVERHEAD bytes more.
+    uint16_t capacity()                  { return ( _pages - 1 ) * ( EEPROM_PAGE_SIZE + 1 - RECORD_MAX ); }
+
+  private:
+    //Record layout: key, length, sequence number (2 bytes), value, CRC-16 (2 bytes).
+    enum { NONE = 0xFF, RECORD_MAX = EEPROM_STORE_VALUE_MAX + EEPROM_STORE_OVERHEAD, PAGES = EEPROM_SIZE / EEPROM_PAGE_SIZE };
+    static_assert( RECORD_MAX <= EEPROM_PAGE_SIZE, "EEPROM_STORE_VALUE_MAX does not fit in a page" );
+
+    static uint8_t first( uint8_t firstPage )               { return firstPage + 2 <= PAGES ? firstPage : PAGES - 2; }
+    static uint8_t count( uint8_t firstPage, uint8_t pages ){ return pages < 2 ? 2 : pages > PAGES - firstPage ? PAGES - firstPage : pages; }
+
+    uint8_t read( uint8_t off )          { return EEPROM.read( _base + off ); }
+    uint8_t length( uint8_t off )        { return read( off + 1 ); }
+    uint16_t sequence( uint8_t off )     { return read( off + 2 ) | ( read( off + 3 ) << 8 ); }
+    uint8_t next( uint8_t page )         { return page + 1 < _pages ? page + 1 : 0; }
+    bool holds( uint8_t page, uint8_t off ){ return off != NONE && (uint8_t) ( off - page * EEPROM_PAGE_SIZE ) < EEPROM_PAGE_SIZE; }
+
+    uint8_t check( uint16_t off, uint16_t end );
+    bool rewrite( uint8_t page, const uint8_t *rec, uint8_t n );
+    static void seal( uint8_t *rec, uint16_t seq );
+
+    const uint16_t _base;
+    const uint8_t _pages;
+    uint8_t _head;                       //Page being appended to.
+    uint8_t _fill;                       //Bytes used in the head page.
+    uint16_t _seq;                       //Sequence number of the newest record.
+    uint8_t _index[ EEPROM_STORE_KEYS ]; //Offset of the newest record of each key.
+};
+
+#endif
@@ -42,15 +42,81 @@ http://arduiniana.org.
 #include <avr/pgmspace.h>
 #include <Arduino.h>
 #include <SoftwareSerial.h>
+#include <SoftwareSerialTiming.h>
 #include <util/delay_basic.h>
+#include <stdlib.h>
+
+// Bit times the timer handles, in timer ticks (CLK_PER/2). Below the
+// minimum the interrupt overhead eats the bit time; above the maximum the
+// signed 16-bit event times could overflow. Outside this range write()
+// falls back to blocking transmit and timer-sampled receive is unavailable.
+#define _SS_TIMER_MIN_TICKS 96
+#define _SS_TIMER_MAX_TICKS 10000
+
+// Ticks from the start bit edge until rxStart() reads the timer. The pin
+// change interrupt gets there about where recv() starts its centering
+// delay, so this is the counted entry path _SS_RX_EDGE_CYCLES in timer
+// ticks. The rest of the latency, from a timer match until the timer
+// interrupt samples the pin, is measured on each frame, see rxEvent().
+// Both are subtracted from the first sample time to center the samples.
+#ifndef _SS_RX_LATENCY
+#define _SS_RX_LATENCY ((_SS_RX_EDGE_CYCLES + 1) / 2)
+#endif
+
+// Events due within this many ticks are handled in the same interrupt
+#define _SS_TIMER_SLACK 4
+
+// The start and stop delays for the usual bit rates are worked out at
+// compile time for the configured F_CPU, which saves the divisions in
+// begin(). The receive centering delay is the time from the start bit
+// edge to the middle of the first data bit, 1.5 bit times. The stop bit
+// delay aims at 3/4 of a bit time after the last data bit, which leaves
+// time for the interrupt cleanup before the next start bit. The bit
+// delays depend on the measured loop cycles, so begin() works them out.
+struct _ss_timing
+{
+  uint32_t speed;
+  uint16_t centering, stopbit;
+};
+
+#define _SS_TIMING(speed) { speed, \
+  _ss_delay(F_CPU * 3 / 2, speed, _SS_RX_START_CYCLES), \
+  _ss_delay(F_CPU * 3 / 4, speed, _SS_RX_STOP_CYCLES) }
+
+static const _ss_timing _ss_timings[] PROGMEM = {
+  _SS_TIMING(57600),
+  _SS_TIMING(38400),
+  _SS_TIMING(31250),
+  _SS_TIMING(28800),
+  _SS_TIMING(19200),
+  _SS_TIMING(14400),
+  _SS_TIMING(9600),
+  _SS_TIMING(4800),
+  _SS_TIMING(2400),
+  _SS_TIMING(1200),
+  _SS_TIMING(600),
+  _SS_TIMING(300),
+};
+
+#if defined(SOFTSERIAL_USE_TIMERB0)
+#define _SS_TIMER TCB0
+#define _SS_TIMER_vect TCB0_INT_vect
+#elif defined(SOFTSERIAL_USE_TIMERB2)
+#define _SS_TIMER TCB2
+#define _SS_TIMER_vect TCB2_INT_vect
+#endif
 
 //
 // Statics
 //
 SoftwareSerial *SoftwareSerial::active_object = 0;
+SoftwareSerial *SoftwareSerial::timer_list = 0;
 uint8_t SoftwareSerial::_receive_buffer[_SS_MAX_RX_BUFF]; 
 volatile uint8_t SoftwareSerial::_receive_buffer_tail = 0;
 volatile uint8_t SoftwareSerial::_receive_buffer_head = 0;
+int16_t SoftwareSerial::_rx_lag = 0;
+uint8_t SoftwareSerial::_rx_bit_cycles = 0;
+uint8_t SoftwareSerial::_tx_bit_cycles = 0;
 
 //
 // Debugging
@@ -89,6 +155,22 @@ bool SoftwareSerial::listen()
   if (!_rx_delay_stopbit)
     return false;
 
+  // Timer-sampled ports listen side by side
+  if (_rx_buffer)
+  {
+    if (_rx_listening)
+      return false;
+    uint8_t oldSREG = SREG;
+    cli();
+    _buffer_overflow = false;
+    _rx_buffer_head = _rx_buffer_tail = 0;
+    _rx_bits = 0;
+    _rx_listening = true;
+    setRxIntMsk(true);
+    SREG = oldSREG;
+    return true;
+  }
+
   if (active_object != this)
   {
     if (active_object)
@@ -108,6 +190,17 @@ bool SoftwareSerial::listen()
 // Stop listening. Returns true if we were actually listening.
 bool SoftwareSerial::stopListening()
 {
+  if (_rx_listening)
+  {
+    uint8_t oldSREG = SREG;
+    cli();
+    setRxIntMsk(false);
+    _rx_listening = false;
+    _rx_active = false;
+    _rx_bits = 0;
+    SREG = oldSREG;
+    return true;
+  }
   if (active_object == this)
   {
     setRxIntMsk(false);
@@ -139,7 +232,7 @@ void SoftwareSerial::recv()
     ::);
 #endif  
 
-  uint8_t d = 0;
+  uint8_t p = _parity_init;
 
   // If RX line is high, then we don't see any start bit
   // so interrupt is probably not for us
@@ -150,32 +243,21 @@ void SoftwareSerial::recv()
     // cause problems at higher baudrates.
     setRxIntMsk(false);
 
-    // Wait approximately 1/2 of a bit width to "center" the sample
+    // Wait until the middle of the first data bit. This is a single
+    // delay so the interrupt entry overhead does not have to fit in half
+    // a bit time.
     tunedDelay(_rx_delay_centering);
-    DebugPulse(_DEBUG_PIN2, 1);
 
-    // Read each of the 8 bits
-    for (uint8_t i=8; i > 0; --i)
-    {
-      tunedDelay(_rx_delay_intrabit);
-      d >>= 1;
-      DebugPulse(_DEBUG_PIN2, 1);
-      if (rx_pin_read())
-        d |= 0x80;
-    }
+    // Read each of the data bits and the parity bit, if any
+    uint16_t d = rxBits(_receivePortRegister, _receiveBitMask, _frame_bits, _rx_delay_intrabit, &p);
 
+    d >>= 16 - _frame_bits;
     if (_inverse_logic)
       d = ~d;
 
+    // Like the UART, drop characters with a parity error
     // if buffer full, set the overflow flag and return
-    uint8_t next = (_receive_buffer_tail + 1) % _SS_MAX_RX_BUFF;
-    if (next != _receive_buffer_head)
-    {
-      // save new data in buffer: tail points to where byte goes
-      _receive_buffer[_receive_buffer_tail] = d; // save new byte
-      _receive_buffer_tail = next;
-    } 
-    else 
+    if ((!_parity || !p) && !bufferPut(_receive_buffer, &_receive_buffer_tail, _receive_buffer_head, d))
     {
       DebugPulse(_DEBUG_PIN1, 1);
       _buffer_overflow = true;
@@ -206,11 +288,364 @@ void SoftwareSerial::recv()
 #endif
 }
 
+// Append a received character to a receive buffer, as two slots for
+// 9-bit frames. Returns false if there is no room.
+bool SoftwareSerial::bufferPut(uint8_t *buffer, volatile uint8_t *tail, uint8_t head, uint16_t d)
+{
+  // tail points to where the character goes
+  uint8_t t = *tail;
+  uint8_t next = (t + 1) % _SS_MAX_RX_BUFF;
+  if (next == head)
+    return false;
+  buffer[t] = d;
+  if (_data_bits > 8)
+  {
+    t = next;
+    next = (t + 1) % _SS_MAX_RX_BUFF;
+    if (next == head)
+      return false;
+    buffer[t] = (d >> 8) & 1;
+  }
+  *tail = next;
+  return true;
+}
+
+// Return the next character from a receive buffer, or -1 if empty
+int SoftwareSerial::bufferGet(const uint8_t *buffer, volatile uint8_t *head, uint8_t tail, bool remove)
+{
+  // read from head
+  uint8_t h = *head;
+  if (h == tail)
+    return -1;
+  int d = buffer[h];
+  h = (h + 1) % _SS_MAX_RX_BUFF;
+  if (_data_bits > 8)
+  {
+    d |= buffer[h] << 8;
+    h = (h + 1) % _SS_MAX_RX_BUFF;
+  }
+  else
+  {
+    d &= (1 << _data_bits) - 1;
+  }
+  if (remove)
+    *head = h;
+  return d;
+}
+
+// Data bits of a character, followed by a zero placeholder for the parity
+// bit when enabled and then stop bits, LSB first
+uint16_t SoftwareSerial::frameBits(uint16_t d)
+{
+  return (d & ((1 << _data_bits) - 1)) | (0x3 << _frame_bits);
+}
+
 uint8_t SoftwareSerial::rx_pin_read()
 {
   return *_receivePortRegister & _receiveBitMask;
 }
 
+// The bit loop of recv(): take bits samples of the pin, delay apart, shift
+// them into the returned value from the top and flip the parity for every
+// one. Not inlined, so measureLoops() times the code that receives.
+/* static */
+uint16_t SoftwareSerial::rxBits(volatile uint8_t *reg, uint8_t mask, uint8_t bits, uint16_t delay, uint8_t *parity)
+{
+  uint16_t d = 0;
+  uint8_t p = *parity;
+
+  for (uint8_t i = bits; ; )
+  {
+    d >>= 1;
+    DebugPulse(_DEBUG_PIN2, 1);
+    if (*reg & mask)
+    {
+      d |= 0x8000;
+      p ^= 1;
+    }
+    if (--i == 0)
+      break;
+    tunedDelay(delay);
+  }
+
+  *parity = p;
+  return d;
+}
+
+// The bit loop of writeFrame(): send bits bits of f, LSB first and delay
+// apart, with the running parity in place of the bit parity_slot counts
+// from the end. Not inlined, so measureLoops() times the code that sends.
+/* static */
+void SoftwareSerial::txBits(volatile uint8_t *reg, uint8_t reg_mask, uint16_t f, uint8_t bits, uint8_t parity_slot, uint8_t p, uint16_t delay)
+{
+  uint8_t inv_mask = ~reg_mask;
+
+  for (uint8_t i = bits; i > 0; --i)
+  {
+    uint8_t out = f & 1;
+    if (i == parity_slot)
+      out = p;
+    p ^= out;
+
+    if (out) // choose bit
+      *reg |= reg_mask; // send 1
+    else
+      *reg &= inv_mask; // send 0
+
+    tunedDelay(delay);
+    f >>= 1;
+  }
+}
+
+// Measure the cycles per bit of rxBits() and txBits() outside their delay
+// against TCA0, which the core runs from CLK_PER/64 for PWM. Each loop is
+// timed over 16 calls for 16 bits and 16 calls for 1 bit; the difference
+// of 240 bits is good to about half a cycle per bit. The receive loop
+// samples the idle receive pin, the transmit loop writes ones and then
+// zeros with an empty pin mask. If TCA0 has been set up some other way,
+// the counted figures from SoftwareSerialTiming.h are kept.
+/* static */
+void SoftwareSerial::measureLoops(volatile uint8_t *rx_reg, uint8_t rx_mask, volatile uint8_t *tx_reg)
+{
+  _rx_bit_cycles = _SS_RX_BIT_CYCLES;
+  _tx_bit_cycles = _SS_TX_BIT_CYCLES;
+
+  uint8_t mode = TCA0.SINGLE.CTRLB & TCA_SINGLE_WGMODE_gm;
+  if ((TCA0.SINGLE.CTRLA & (TCA_SINGLE_CLKSEL_gm | TCA_SINGLE_ENABLE_bm)) != (TCA_SINGLE_CLKSEL_DIV64_gc | TCA_SINGLE_ENABLE_bm) ||
+      (TCA0.SINGLE.CTRLD & TCA_SINGLE_SPLITM_bm) ||
+      (TCA0.SINGLE.CTRLESET & TCA_SINGLE_DIR_bm) ||
+      (mode != TCA_SINGLE_WGMODE_NORMAL_gc && mode != TCA_SINGLE_WGMODE_SINGLESLOPE_gc) ||
+      TCA0.SINGLE.PER < 0xFF)
+    return;
+
+  uint16_t ticks[6];
+  for (uint8_t k = 0; k < 6; ++k)
+  {
+    uint8_t bits = (k & 1) ? 16 : 1;
+    uint8_t oldSREG = SREG;
+    cli();
+    uint16_t start = TCA0.SINGLE.CNT;
+    for (uint8_t j = 16; j > 0; --j)
+    {
+      uint8_t p = 0;
+      if (k < 2)
+        rxBits(rx_reg, rx_mask, bits, 1, &p);
+      else
+        txBits(tx_reg, 0, k < 4 ? 0xFFFF : 0, bits, 0, p, 1);
+    }
+    uint16_t end = TCA0.SINGLE.CNT;
+    SREG = oldSREG;
+    if (end < start)
+      end += TCA0.SINGLE.PER + 1;
+    ticks[k] = end - start;
+  }
+
+  int16_t rx = _ss_loop_cycles(ticks[1], ticks[0]);
+  int16_t tx = (_ss_loop_cycles(ticks[3], ticks[2]) + _ss_loop_cycles(ticks[5], ticks[4]) + 1) / 2;
+  if (rx > 0 && rx < 64)
+    _rx_bit_cycles = rx;
+  if (tx > 0 && tx < 64)
+    _tx_bit_cycles = tx;
+}
+
+#if defined(_SS_TIMER)
+
+//
+// Timer driven transmit
+//
+// A single TCB in periodic mode serves all ports. Each pending event is
+// kept as a tick count relative to the start of the current timer period,
+// and the compare value is set to the earliest of them. Events are
+// rescheduled relative to their own due time, so interrupt latency gives
+// jitter but never accumulates drift.
+//
+
+// Send the next bit, or pick up the next byte when the previous stop bit
+// is complete. Called with interrupts disabled.
+void SoftwareSerial::txEvent()
+{
+  if (_tx_bits == 0)
+  {
+    if (_tx_buffer_head == _tx_buffer_tail)
+    {
+      _tx_active = false;
+      return;
+    }
+    uint8_t h = _tx_buffer_head;
+    uint16_t d = _tx_buffer[h];
+    h = (h + 1) % _SS_MAX_TX_BUFF;
+    if (_data_bits > 8)
+    {
+      d |= _tx_buffer[h] << 8;
+      h = (h + 1) % _SS_MAX_TX_BUFF;
+    }
+    _tx_buffer_head = h;
+
+    // start bit, data bits, parity placeholder and stop bits, as levels
+    _tx_frame = frameBits(d) << 1;
+    if (_inverse_logic)
+      _tx_frame = ~_tx_frame;
+    _tx_bits = 1 + _frame_bits + _stop_bits;
+    _tx_parity = _parity_init ^ _inverse_logic;
+  }
+
+  uint8_t out = _tx_frame & 1;
+  if (_parity && _tx_bits == _stop_bits + 1)
+    out = _tx_parity;
+  _tx_parity ^= out;
+
+  if (out)
+    *_transmitPortRegister |= _transmitBitMask;
+  else
+    *_transmitPortRegister &= ~_transmitBitMask;
+
+  _tx_frame >>= 1;
+  --_tx_bits;
+  _tx_due += _bit_ticks;
+}
+
+// Start bit edge seen on a timer-sampled port: mask the pin interrupt for
+// the rest of the frame and schedule the first sample in the middle of
+// the first data bit. Called with interrupts disabled.
+void SoftwareSerial::rxStart()
+{
+  if (_inverse_logic ? !rx_pin_read() : rx_pin_read())
+    return;
+
+  setRxIntMsk(false);
+  _rx_frame = 0;
+  _rx_parity = _parity_init;
+  _rx_bits = _frame_bits + 1;
+  _rx_active = true;
+  _rx_due = timerNow() + _bit_ticks + _bit_ticks / 2 - _SS_RX_LATENCY - _rx_lag;
+  timerUpdate(_rx_due);
+}
+
+// Sample the next data or parity bit, or store the character when sampling
+// the stop bit.
+// Called with interrupts disabled.
+void SoftwareSerial::rxEvent()
+{
+  if (--_rx_bits)
+  {
+    // Keep a running average of how late the timer interrupt takes the
+    // first sample, which rxStart() allows for in the next frame
+    if (_rx_bits == _frame_bits)
+      _rx_lag += ((int16_t)_SS_TIMER.CNT - _rx_due - _rx_lag) / 4;
+
+    uint16_t d = _rx_frame >> 1;
+    if (rx_pin_read())
+    {
+      d |= 0x8000;
+      _rx_parity ^= 1;
+    }
+    _rx_frame = d;
+    _rx_due += _bit_ticks;
+    return;
+  }
+
+  uint16_t d = _rx_frame >> (16 - _frame_bits);
+  if (_inverse_logic)
+    d = ~d;
+
+  if ((!_parity || !_rx_parity) && !bufferPut(_rx_buffer, &_rx_buffer_tail, _rx_buffer_head, d))
+    _buffer_overflow = true;
+
+  // Half a bit remains before the next start bit can begin
+  _rx_active = false;
+  setRxIntMsk(true);
+}
+
+// Current time in ticks relative to the start of the timer period the
+// pending events are counted from. Called with interrupts disabled.
+/* static */
+int16_t SoftwareSerial::timerNow()
+{
+  if (!(_SS_TIMER.CTRLA & TCB_ENABLE_bm))
+    return 0;
+
+  // Read the counter before the flag. If a new period has started but the
+  // interrupt has not yet moved the pending events to it, a low count was
+  // read after the wrap; a high one was read just before it.
+  uint16_t cnt = _SS_TIMER.CNT;
+  uint16_t top = _SS_TIMER.CCMP;
+  if ((_SS_TIMER.INTFLAGS & TCB_CAPT_bm) && cnt < top / 2)
+    cnt += top + 1;
+  return cnt;
+}
+
+// Make sure the timer fires no later than due. Called with interrupts
+// disabled.
+/* static */
+void SoftwareSerial::timerUpdate(int16_t due)
+{
+  if (!(_SS_TIMER.CTRLA & TCB_ENABLE_bm))
+  {
+    _SS_TIMER.CNT = 0;
+    _SS_TIMER.CCMP = due;
+    _SS_TIMER.INTFLAGS = TCB_CAPT_bm;
+    _SS_TIMER.CTRLA = TCB_CLKSEL_CLKDIV2_gc | TCB_ENABLE_bm;
+  }
+  else if (!(_SS_TIMER.INTFLAGS & TCB_CAPT_bm) && (uint16_t)due < _SS_TIMER.CCMP)
+  {
+    // if the flag is set, the interrupt will work out the next period
+    _SS_TIMER.CCMP = due;
+  }
+}
+
+void SoftwareSerial::timerAttach()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  if (!timer_list)
+  {
+    _SS_TIMER.CTRLA = 0;
+    _SS_TIMER.CTRLB = TCB_CNTMODE_INT_gc;
+    _SS_TIMER.INTCTRL = TCB_CAPT_bm;
+  }
+  SoftwareSerial **p = &timer_list;
+  while (*p && *p != this)
+    p = &(*p)->_timer_next;
+  if (!*p)
+  {
+    _timer_next = NULL;
+    *p = this;
+  }
+  SREG = oldSREG;
+}
+
+void SoftwareSerial::timerDetach()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  _tx_active = false;
+  _tx_bits = 0;
+  _rx_active = false;
+  _rx_bits = 0;
+  for (SoftwareSerial **p = &timer_list; *p; p = &(*p)->_timer_next)
+  {
+    if (*p == this)
+    {
+      *p = _timer_next;
+      break;
+    }
+  }
+  if (!timer_list)
+  {
+    _SS_TIMER.CTRLA = 0;
+    _SS_TIMER.INTCTRL = 0;
+  }
+  SREG = oldSREG;
+}
+
+#else
+
+// No timer selected, so the buffered modes are never entered
+void SoftwareSerial::timerAttach() {}
+void SoftwareSerial::timerDetach() {}
+
+#endif
+
 //
 // Interrupt handling
 //
@@ -222,8 +657,86 @@ inline void SoftwareSerial::handle_interrupt()
   {
     active_object->recv();
   }
+
+#if defined(_SS_TIMER)
+  // The pin interrupt does not tell which pin changed, so look for a
+  // start bit on every idle timer-sampled port
+  for (SoftwareSerial *p = timer_list; p; p = p->_timer_next)
+  {
+    if (p->_rx_listening && !p->_rx_active)
+      p->rxStart();
+  }
+#endif
+}
+
+#if defined(_SS_TIMER)
+
+/* static */
+inline void SoftwareSerial::handle_timer()
+{
+  _SS_TIMER.INTFLAGS = TCB_CAPT_bm;
+
+  // Move all events to the period that just started
+  int16_t elapsed = _SS_TIMER.CCMP + 1;
+  int16_t next = 0x7FFF;
+
+  for (SoftwareSerial *p = timer_list; p; p = p->_timer_next)
+  {
+    if (p->_rx_active)
+    {
+      p->_rx_due -= elapsed;
+      if (p->_rx_due <= (int16_t)_SS_TIMER.CNT + _SS_TIMER_SLACK)
+        p->rxEvent();
+      if (p->_rx_active && p->_rx_due < next)
+        next = p->_rx_due;
+    }
+    if (p->_tx_active)
+    {
+      p->_tx_due -= elapsed;
+      if (p->_tx_due <= (int16_t)_SS_TIMER.CNT + _SS_TIMER_SLACK)
+        p->txEvent();
+      if (p->_tx_active && p->_tx_due < next)
+        next = p->_tx_due;
+    }
+  }
+
+  if (next == 0x7FFF)
+  {
+    _SS_TIMER.CTRLA = 0;
+    return;
+  }
+
+  // Never set the compare value behind the counter
+  int16_t now = _SS_TIMER.CNT + _SS_TIMER_SLACK;
+  if (next < now)
+    next = now;
+  _SS_TIMER.CCMP = next;
+}
+
+ISR(_SS_TIMER_vect)
+{
+  SoftwareSerial::handle_timer();
+}
+
+// Run the timer interrupt handler if it is pending, for use when waiting
+// with interrupts possibly disabled
+/* static */
+void SoftwareSerial::timerPoll()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  if (_SS_TIMER.INTFLAGS & TCB_CAPT_bm)
+    handle_timer();
+  SREG = oldSREG;
 }
 
+#else
+
+/* static */
+void SoftwareSerial::timerPoll() {}
+
+#endif
+
 //
 // Constructor
 //
@@ -233,7 +746,25 @@ SoftwareSerial::SoftwareSerial(uint8_t receivePin, uint8_t transmitPin, bool inv
   _rx_delay_stopbit(0),
   _tx_delay(0),
   _buffer_overflow(false),
-  _inverse_logic(inverse_logic)
+  _inverse_logic(inverse_logic),
+  _data_bits(8),
+  _frame_bits(8),
+  _stop_bits(1),
+  _parity(0),
+  _parity_init(0),
+  _tx_buffer(NULL),
+  _tx_buffer_tail(0),
+  _tx_buffer_head(0),
+  _tx_bits(0),
+  _tx_active(false),
+  _bit_ticks(0),
+  _rx_buffer(NULL),
+  _rx_buffer_tail(0),
+  _rx_buffer_head(0),
+  _rx_bits(0),
+  _rx_active(false),
+  _rx_listening(false),
+  _timer_next(NULL)
 {
   setTX(transmitPin);
   setRX(receivePin);
@@ -245,6 +776,8 @@ SoftwareSerial::SoftwareSerial(uint8_t receivePin, uint8_t transmitPin, bool inv
 SoftwareSerial::~SoftwareSerial()
 {
   end();
+  free(_tx_buffer);
+  free(_rx_buffer);
 }
 
 void SoftwareSerial::setTX(uint8_t tx)
@@ -269,13 +802,8 @@ void SoftwareSerial::setRX(uint8_t rx)
   _receiveBitMask = digitalPinToBitMask(rx);
   uint8_t port = digitalPinToPort(rx);
   _receivePortRegister = portInputRegister(port);
-}
-
-uint16_t SoftwareSerial::subtract_cap(uint16_t num, uint16_t sub) {
-  if (num > sub)
-    return num - sub;
-  else
-    return 1;
+  _pcint_maskreg = getPINnCTRLregister(digitalPinToPortStruct(rx), digitalPinToBitPosition(rx));
+  _pcint_maskvalue = PORT_ISC_BOTHEDGES_gc;
 }
 
 //
@@ -284,55 +812,66 @@ uint16_t SoftwareSerial::subtract_cap(uint16_t num, uint16_t sub) {
 
 void SoftwareSerial::begin(long speed)
 {
-  _rx_delay_centering = _rx_delay_intrabit = _rx_delay_stopbit = _tx_delay = 0;
+  begin(speed, SERIAL_8N1);
+}
+
+// Start with the given frame format: one of the SERIAL_* config values
+// also taken by the UART, or SERIAL_9N1 and friends for 9-bit frames. The
+// receiver checks only the first stop bit.
+void SoftwareSerial::begin(long speed, uint16_t config)
+{
+  // Timer-sampled receive must be idle while the timings change
+  if (_rx_buffer)
+    stopListening();
+
+  // Wait for queued characters to go out in the old format
+  flush();
+
+  uint8_t chsize = config & USART_CHSIZE_gm;
+  _data_bits = chsize >= USART_CHSIZE_9BITL_gc ? 9 : 5 + chsize;
+  _parity = (config & USART_PMODE_gm) != USART_PMODE_DISABLED_gc;
+  _frame_bits = _data_bits + _parity;
+  _stop_bits = (config & USART_SBMODE_gm) == USART_SBMODE_2BIT_gc ? 2 : 1;
+
+  // Parity is tracked on the line levels, with inverse logic too. Both
+  // directions start from this value: the transmitter sends the result as
+  // parity bit, and the receiver accepts a character if it ends up as 0
+  // after the data and parity bits.
+  _parity_init = ((config & USART_PMODE_gm) == USART_PMODE_ODD_gc) ^ (_inverse_logic && !(_data_bits & 1));
+
+  _ss_timing t;
+  uint8_t i = 0;
+  uint8_t n = sizeof(_ss_timings) / sizeof(_ss_timings[0]);
+  while (i < n && (long)pgm_read_dword(&_ss_timings[i].speed) != speed)
+    ++i;
+  if (i < n)
+  {
+    memcpy_P(&t, &_ss_timings[i], sizeof(t));
+  }
+  else
+  {
+    t.centering = _ss_delay(F_CPU * 3 / 2, speed, _SS_RX_START_CYCLES);
+    t.stopbit = _ss_delay(F_CPU * 3 / 4, speed, _SS_RX_STOP_CYCLES);
+  }
 
-  // Precalculate the various delays, in number of 4-cycle delays
-  uint16_t bit_delay = (F_CPU / speed) / 4;
+  if (!_tx_bit_cycles)
+    measureLoops(_receivePortRegister, _receiveBitMask, _transmitPortRegister);
 
-  // 12 (gcc 4.8.2) or 13 (gcc 4.3.2) cycles from start bit to first bit,
-  // 15 (gcc 4.8.2) or 16 (gcc 4.3.2) cycles between bits,
-  // 12 (gcc 4.8.2) or 14 (gcc 4.3.2) cycles from last bit to stop bit
-  // These are all close enough to just use 15 cycles, since the inter-bit
-  // timings are the most critical (deviations stack 8 times)
-  _tx_delay = subtract_cap(bit_delay, 15 / 4);
+  _tx_delay = _ss_delay(F_CPU, speed, _tx_bit_cycles);
+
+  // Bit time for the transmit timer, which runs at CLK_PER/2
+  uint32_t ticks = (F_CPU / 2 + speed / 2) / speed;
+  _bit_ticks = (ticks >= _SS_TIMER_MIN_TICKS && ticks <= _SS_TIMER_MAX_TICKS) ? ticks : 0;
+  if (_tx_buffer || _rx_buffer)
+    timerAttach();
 
   // Only setup rx when we have a valid PCINT for this pin
   if (1) {
-    #if GCC_VERSION > 40800
-    // Timings counted from gcc 4.8.2 output. This works up to 115200 on
-    // 16Mhz and 57600 on 8Mhz.
-    //
-    // When the start bit occurs, there are 3 or 4 cycles before the
-    // interrupt flag is set, 4 cycles before the PC is set to the right
-    // interrupt vector address and the old PC is pushed on the stack,
-    // and then 75 cycles of instructions (including the RJMP in the
-    // ISR vector table) until the first delay. After the delay, there
-    // are 17 more cycles until the pin value is read (excluding the
-    // delay in the loop).
-    // We want to have a total delay of 1.5 bit time. Inside the loop,
-    // we already wait for 1 bit time - 23 cycles, so here we wait for
-    // 0.5 bit time - (71 + 18 - 22) cycles.
-    _rx_delay_centering = subtract_cap(bit_delay / 2, (4 + 4 + 75 + 17 - 23) / 4);
-
-    // There are 23 cycles in each loop iteration (excluding the delay)
-    _rx_delay_intrabit = subtract_cap(bit_delay, 23 / 4);
-
-    // There are 37 cycles from the last bit read to the start of
-    // stopbit delay and 11 cycles from the delay until the interrupt
-    // mask is enabled again (which _must_ happen during the stopbit).
-    // This delay aims at 3/4 of a bit time, meaning the end of the
-    // delay will be at 1/4th of the stopbit. This allows some extra
-    // time for ISR cleanup, which makes 115200 baud at 16Mhz work more
-    // reliably
-    _rx_delay_stopbit = subtract_cap(bit_delay * 3 / 4, (37 + 11) / 4);
-    #else // Timings counted from gcc 4.3.2 output
-    // Note that this code is a _lot_ slower, mostly due to bad register
-    // allocation choices of gcc. This works up to 57600 on 16Mhz and
-    // 38400 on 8Mhz.
-    _rx_delay_centering = subtract_cap(bit_delay / 2, (4 + 4 + 97 + 29 - 11) / 4);
-    _rx_delay_intrabit = subtract_cap(bit_delay, 11 / 4);
-    _rx_delay_stopbit = subtract_cap(bit_delay * 3 / 4, (44 + 17) / 4);
-    #endif
+    // Account for the pins the port interrupt handler looks at first
+    uint16_t pin_delay = (digitalPinToBitPosition(_receivePin) * _SS_RX_PIN_CYCLES + 2) / 4;
+    _rx_delay_centering = t.centering > pin_delay ? t.centering - pin_delay : 1;
+    _rx_delay_intrabit = _ss_delay(F_CPU, speed, _rx_bit_cycles);
+    _rx_delay_stopbit = t.stopbit;
 
     attachInterrupt(_receivePin, SoftwareSerial::handle_interrupt, CHANGE);
 
@@ -344,20 +883,121 @@ void SoftwareSerial::begin(long speed)
   pinMode(_DEBUG_PIN2, OUTPUT);
 #endif
 
+  // setRxMode() before begin() could not check the bit rate
+  if (_rx_buffer && !_bit_ticks)
+    setRxMode(SS_RX_BLOCKING);
+
   listen();
 }
 
+// Enable or disable the pin interrupt by way of its sense configuration
 void SoftwareSerial::setRxIntMsk(bool enable)
 {
     if (enable)
-      *_pcint_maskreg |= _pcint_maskvalue;
+      *_pcint_maskreg = (*_pcint_maskreg & ~PORT_ISC_gm) | _pcint_maskvalue;
     else
-      *_pcint_maskreg &= ~_pcint_maskvalue;
+      *_pcint_maskreg &= ~PORT_ISC_gm;
 }
 
 void SoftwareSerial::end()
 {
   stopListening();
+  if (_tx_buffer || _rx_buffer)
+  {
+    flush();
+    timerDetach();
+  }
+}
+
+// Select blocking transmit, where write() returns once the byte has been
+// sent with interrupts disabled, or interrupt-driven transmit, where
+// write() queues the byte and the shared timer shifts out one bit per
+// interrupt. Returns false if no timer is selected or the transmit buffer
+// cannot be allocated.
+// Interrupt-driven transmit is used for bit rates of roughly 1200 to
+// 57600 baud; write() falls back to blocking transmit outside that range.
+bool SoftwareSerial::setTxMode(uint8_t mode)
+{
+#if !defined(_SS_TIMER)
+  if (mode == SS_TX_INTERRUPT)
+    return false;
+#endif
+
+  if (mode == SS_TX_INTERRUPT)
+  {
+    if (!_tx_buffer)
+    {
+      _tx_buffer = (uint8_t *)malloc(_SS_MAX_TX_BUFF);
+      if (!_tx_buffer)
+        return false;
+      _tx_buffer_head = _tx_buffer_tail = 0;
+    }
+    if (_tx_delay)
+      timerAttach();
+  }
+  else if (_tx_buffer)
+  {
+    flush();
+    if (_rx_buffer)
+      _tx_active = false;
+    else
+      timerDetach();
+    free(_tx_buffer);
+    _tx_buffer = NULL;
+  }
+  return true;
+}
+
+// Select blocking receive, where the pin change interrupt handler reads
+// the whole byte and only one port can listen at a time, or timer-sampled
+// receive, where the start bit edge only arms the shared timer and each
+// bit is sampled in a short timer interrupt. Timer-sampled ports each have
+// their own buffer and can all listen at the same time, also while
+// transmitting with SS_TX_INTERRUPT. Returns false if no timer is
+// selected, the receive buffer cannot be allocated or the bit rate set by
+// begin() is out of range for the timer.
+bool SoftwareSerial::setRxMode(uint8_t mode)
+{
+  bool listening = isListening();
+  stopListening();
+
+#if !defined(_SS_TIMER)
+  mode = SS_RX_BLOCKING;
+#endif
+
+  if (mode == SS_RX_TIMER)
+  {
+    if (_rx_delay_stopbit && !_bit_ticks)
+      mode = SS_RX_BLOCKING;
+    else if (!_rx_buffer)
+    {
+      _rx_buffer = (uint8_t *)malloc(_SS_MAX_RX_BUFF);
+      if (!_rx_buffer)
+        mode = SS_RX_BLOCKING;
+    }
+  }
+
+  if (mode == SS_RX_TIMER)
+  {
+    _pcint_maskvalue = _inverse_logic ? PORT_ISC_RISING_gc : PORT_ISC_FALLING_gc;
+    if (_rx_delay_stopbit)
+      timerAttach();
+  }
+  else
+  {
+    _pcint_maskvalue = PORT_ISC_BOTHEDGES_gc;
+    if (_rx_buffer)
+    {
+      if (!_tx_buffer)
+        timerDetach();
+      free(_rx_buffer);
+      _rx_buffer = NULL;
+    }
+  }
+
+  if (listening)
+    listen();
+  return mode == SS_RX_TIMER;
 }
 
 
@@ -367,14 +1007,9 @@ int SoftwareSerial::read()
   if (!isListening())
     return -1;
 
-  // Empty buffer?
-  if (_receive_buffer_head == _receive_buffer_tail)
-    return -1;
-
-  // Read from "head"
-  uint8_t d = _receive_buffer[_receive_buffer_head]; // grab next byte
-  _receive_buffer_head = (_receive_buffer_head + 1) % _SS_MAX_RX_BUFF;
-  return d;
+  if (_rx_buffer)
+    return bufferGet(_rx_buffer, &_rx_buffer_head, _rx_buffer_tail, true);
+  return bufferGet(_receive_buffer, &_receive_buffer_head, _receive_buffer_tail, true);
 }
 
 int SoftwareSerial::available()
@@ -382,67 +1017,128 @@ int SoftwareSerial::available()
   if (!isListening())
     return 0;
 
-  return (_receive_buffer_tail + _SS_MAX_RX_BUFF - _receive_buffer_head) % _SS_MAX_RX_BUFF;
+  int n;
+  if (_rx_buffer)
+    n = (_rx_buffer_tail + _SS_MAX_RX_BUFF - _rx_buffer_head) % _SS_MAX_RX_BUFF;
+  else
+    n = (_receive_buffer_tail + _SS_MAX_RX_BUFF - _receive_buffer_head) % _SS_MAX_RX_BUFF;
+
+  // 9-bit characters take two slots
+  return _data_bits > 8 ? n / 2 : n;
+}
+
+int SoftwareSerial::availableForWrite()
+{
+  if (!_tx_buffer || !_bit_ticks)
+    return 0;
+
+  uint8_t oldSREG = SREG;
+  cli();
+  uint8_t used = (_tx_buffer_tail + _SS_MAX_TX_BUFF - _tx_buffer_head) % _SS_MAX_TX_BUFF;
+  SREG = oldSREG;
+  uint8_t room = _SS_MAX_TX_BUFF - 1 - used;
+  return _data_bits > 8 ? room / 2 : room;
 }
 
 size_t SoftwareSerial::write(uint8_t b)
+{
+  return writeFrame(b);
+}
+
+// Send a character of up to 9 bits, for 9-bit frames
+size_t SoftwareSerial::write9bit(uint16_t d)
+{
+  return writeFrame(d);
+}
+
+size_t SoftwareSerial::writeFrame(uint16_t d)
 {
   if (_tx_delay == 0) {
     setWriteError();
     return 0;
   }
 
+#if defined(_SS_TIMER)
+  if (_tx_buffer && _bit_ticks)
+  {
+    uint8_t slots = _data_bits > 8 ? 2 : 1;
+
+    // Wait for room, running the timer handler ourselves in case
+    // interrupts are disabled
+    while ((uint8_t)((_tx_buffer_head + _SS_MAX_TX_BUFF - _tx_buffer_tail - 1) % _SS_MAX_TX_BUFF) < slots)
+      timerPoll();
+
+    uint8_t t = _tx_buffer_tail;
+    _tx_buffer[t] = d;
+    t = (t + 1) % _SS_MAX_TX_BUFF;
+    if (slots > 1)
+    {
+      _tx_buffer[t] = d >> 8;
+      t = (t + 1) % _SS_MAX_TX_BUFF;
+    }
+
+    uint8_t oldSREG = SREG;
+    cli();
+    _tx_buffer_tail = t;
+    if (!_tx_active)
+    {
+      // Idle: send the start bit now and schedule the rest
+      _tx_active = true;
+      _tx_due = timerNow();
+      txEvent();
+      timerUpdate(_tx_due);
+    }
+    SREG = oldSREG;
+    return 1;
+  }
+#endif
+
   // By declaring these as local variables, the compiler will put them
   // in registers _before_ disabling interrupts and entering the
   // critical timing sections below, which makes it a lot easier to
   // verify the cycle timings
   volatile uint8_t *reg = _transmitPortRegister;
   uint8_t reg_mask = _transmitBitMask;
-  uint8_t inv_mask = ~_transmitBitMask;
   uint8_t oldSREG = SREG;
   bool inv = _inverse_logic;
   uint16_t delay = _tx_delay;
+  uint8_t bits = _frame_bits + 1;
+  uint8_t parity_slot = _parity ? 1 : 0;
+  // The start bit is the first bit of the loop, which also takes its line
+  // level into the parity
+  uint8_t p = _parity_init ^ inv;
+  uint16_t f = frameBits(d) << 1;
 
   if (inv)
-    b = ~b;
+    f = ~f;
 
   cli();  // turn off interrupts for a clean txmit
 
-  // Write the start bit
-  if (inv)
-    *reg |= reg_mask;
-  else
-    *reg &= inv_mask;
-
-  tunedDelay(delay);
-
-  // Write each of the 8 bits
-  for (uint8_t i = 8; i > 0; --i)
-  {
-    if (b & 1) // choose bit
-      *reg |= reg_mask; // send 1
-    else
-      *reg &= inv_mask; // send 0
-
-    tunedDelay(delay);
-    b >>= 1;
-  }
+  // Write the start bit and each of the data bits, then the parity bit
+  // worked out on the way
+  txBits(reg, reg_mask, f, bits, parity_slot, p, delay);
 
   // restore pin to natural state
   if (inv)
-    *reg &= inv_mask;
+    *reg &= ~reg_mask;
   else
     *reg |= reg_mask;
 
   SREG = oldSREG; // turn interrupts back on
-  tunedDelay(_tx_delay);
+  for (uint8_t i = _stop_bits; i > 0; --i)
+    tunedDelay(_tx_delay);
   
   return 1;
 }
 
 void SoftwareSerial::flush()
 {
-  // There is no tx buffering, simply return
+  // Wait until interrupt-driven transmit is done, including the stop bit
+  if (_tx_buffer)
+  {
+    while (_tx_active)
+      timerPoll();
+  }
 }
 
 int SoftwareSerial::peek()
@@ -450,10 +1146,7 @@ int SoftwareSerial::peek()
   if (!isListening())
     return -1;
 
-  // Empty buffer?
-  if (_receive_buffer_head == _receive_buffer_tail)
-    return -1;
-
-  // Read from "head"
-  return _receive_buffer[_receive_buffer_head];
+  if (_rx_buffer)
+    return bufferGet(_rx_buffer, &_rx_buffer_head, _rx_buffer_tail, false);
+  return bufferGet(_receive_buffer, &_receive_buffer_head, _receive_buffer_tail, false);
 }
@@ -43,6 +43,36 @@ http://arduiniana.org.
 #define _SS_MAX_RX_BUFF 64 // RX buffer size
 #endif
 
+#ifndef _SS_MAX_TX_BUFF
+#define _SS_MAX_TX_BUFF 32 // TX buffer size, interrupt-driven transmit only
+#endif
+
+// Timer used for interrupt-driven transmit and timer-sampled receive. TCB3 is used for millis() and
+// TCB1 for tone(), so one of the two remaining timers must be sacrificed. None is taken unless
+// selected here or in the build flags; without one, setTxMode(SS_TX_INTERRUPT) and
+// setRxMode(SS_RX_TIMER) return false.
+/*
+#define SOFTSERIAL_USE_TIMERB2        // interferes with PWM on pin 11
+#define SOFTSERIAL_USE_TIMERB0        // interferes with PWM on pin 6
+*/
+
+// Transmit modes, see setTxMode()
+#define SS_TX_BLOCKING  0
+#define SS_TX_INTERRUPT 1
+
+// 9-bit frame formats for begin(), next to the SERIAL_* formats the UART
+// defines. Use write9bit() to send the ninth bit.
+#ifndef SERIAL_9N1
+#define SERIAL_9N1 (USART_CMODE_ASYNCHRONOUS_gc | USART_CHSIZE_9BITL_gc | USART_PMODE_DISABLED_gc | USART_SBMODE_1BIT_gc)
+#define SERIAL_9N2 (USART_CMODE_ASYNCHRONOUS_gc | USART_CHSIZE_9BITL_gc | USART_PMODE_DISABLED_gc | USART_SBMODE_2BIT_gc)
+#define SERIAL_9E1 (USART_CMODE_ASYNCHRONOUS_gc | USART_CHSIZE_9BITL_gc | USART_PMODE_EVEN_gc | USART_SBMODE_1BIT_gc)
+#define SERIAL_9O1 (USART_CMODE_ASYNCHRONOUS_gc | USART_CHSIZE_9BITL_gc | USART_PMODE_ODD_gc | USART_SBMODE_1BIT_gc)
+#endif
+
+// Receive modes, see setRxMode()
+#define SS_RX_BLOCKING  0
+#define SS_RX_TIMER     1
+
 #ifndef GCC_VERSION
 #define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
 #endif
@@ -68,21 +98,68 @@ private:
   uint16_t _buffer_overflow:1;
   uint16_t _inverse_logic:1;
 
+  // Frame format
+  uint8_t _data_bits;
+  uint8_t _frame_bits;          // data bits plus parity bit
+  uint8_t _stop_bits;
+  uint8_t _parity;              // 1 if a parity bit is sent
+  uint8_t _parity_init;         // running parity start value, see begin()
+
+  // Interrupt-driven transmit; the buffer is only allocated in that mode
+  uint8_t *_tx_buffer;
+  volatile uint8_t _tx_buffer_tail;
+  volatile uint8_t _tx_buffer_head;
+  volatile uint16_t _tx_frame;  // remaining bits of current frame, LSB first
+  volatile uint8_t _tx_bits;    // number of bits left in _tx_frame
+  volatile uint8_t _tx_parity;  // running parity of the current frame
+  volatile bool _tx_active;     // a transmit timer event is pending
+  volatile int16_t _tx_due;     // timer ticks from start of timer period
+  uint16_t _bit_ticks;          // one bit time in timer ticks, 0 if out of range
+
+  // Timer-sampled receive; the buffer is only allocated in that mode
+  uint8_t *_rx_buffer;
+  volatile uint8_t _rx_buffer_tail;
+  volatile uint8_t _rx_buffer_head;
+  volatile uint16_t _rx_frame;  // bits received so far, shifted in from the top
+  volatile uint8_t _rx_parity;  // running parity of the current frame
+  volatile uint8_t _rx_bits;    // number of samples left, 0 if idle
+  volatile bool _rx_active;     // a receive timer event is pending
+  bool _rx_listening;
+  volatile int16_t _rx_due;     // timer ticks from start of timer period
+
+  SoftwareSerial *_timer_next;
+
   // static data
   static uint8_t _receive_buffer[_SS_MAX_RX_BUFF]; 
   static volatile uint8_t _receive_buffer_tail;
   static volatile uint8_t _receive_buffer_head;
   static SoftwareSerial *active_object;
+  static SoftwareSerial *timer_list;
+  static int16_t _rx_lag;         // timer interrupt sampling latency in ticks
+  static uint8_t _rx_bit_cycles;  // measured loop cycles per bit, 0 until begin()
+  static uint8_t _tx_bit_cycles;
 
   // private methods
   inline void recv() __attribute__((__always_inline__));
   uint8_t rx_pin_read();
+  static uint16_t rxBits(volatile uint8_t *reg, uint8_t mask, uint8_t bits, uint16_t delay, uint8_t *parity) __attribute__((__noinline__));
+  static void txBits(volatile uint8_t *reg, uint8_t reg_mask, uint16_t f, uint8_t bits, uint8_t parity_slot, uint8_t p, uint16_t delay) __attribute__((__noinline__));
+  static void measureLoops(volatile uint8_t *rx_reg, uint8_t rx_mask, volatile uint8_t *tx_reg);
   void setTX(uint8_t transmitPin);
   void setRX(uint8_t receivePin);
+  bool bufferPut(uint8_t *buffer, volatile uint8_t *tail, uint8_t head, uint16_t d);
+  int bufferGet(const uint8_t *buffer, volatile uint8_t *head, uint8_t tail, bool remove);
+  uint16_t frameBits(uint16_t d);
+  size_t writeFrame(uint16_t d);
   inline void setRxIntMsk(bool enable) __attribute__((__always_inline__));
-
-  // Return num - sub, or 1 if the result would be < 1
-  static uint16_t subtract_cap(uint16_t num, uint16_t sub);
+  inline void txEvent() __attribute__((__always_inline__));
+  inline void rxStart() __attribute__((__always_inline__));
+  inline void rxEvent() __attribute__((__always_inline__));
+  void timerAttach();
+  void timerDetach();
+  static int16_t timerNow();
+  static void timerUpdate(int16_t due);
+  static void timerPoll();
 
   // private static method for timing
   static inline void tunedDelay(uint16_t delay);
@@ -92,16 +169,21 @@ public:
   SoftwareSerial(uint8_t receivePin, uint8_t transmitPin, bool inverse_logic = false);
   ~SoftwareSerial();
   void begin(long speed);
+  void begin(long speed, uint16_t config);
   bool listen();
   void end();
-  bool isListening() { return this == active_object; }
+  bool isListening() { return this == active_object || _rx_listening; }
   bool stopListening();
   bool overflow() { bool ret = _buffer_overflow; if (ret) _buffer_overflow = false; return ret; }
   int peek();
+  bool setTxMode(uint8_t mode);
+  bool setRxMode(uint8_t mode);
 
   virtual size_t write(uint8_t byte);
+  size_t write9bit(uint16_t data);
   virtual int read();
   virtual int available();
+  virtual int availableForWrite();
   virtual void flush();
   operator bool() { return true; }
   
@@ -109,6 +191,7 @@ public:
 
   // public only for easy access by interrupt handlers
   static inline void handle_interrupt() __attribute__((__always_inline__));
+  static inline void handle_timer() __attribute__((__always_inline__));
 };
 
 // Arduino 0012 workaround
@@ -0,0 +1,103 @@
+/*
+SoftwareSerialTiming.h - cycle model and delay calculation of the
+blocking bit loops in SoftwareSerial.cpp. Kept free of AVR headers so the
+delay calculation can be tested on the host (see cores/test).
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+*/
+
+#ifndef SoftwareSerialTiming_h
+#define SoftwareSerialTiming_h
+
+#include <stdint.h>
+
+#ifndef GCC_VERSION
+#define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
+#endif
+
+//
+// Cycle model of the bit loops in recv() and write(), in CPU cycles
+// excluding the tunedDelay() calls, which take 4 cycles per count.
+//
+// The figures are the ones counted for the ATmega328 build of these
+// loops and have not been recounted for megaAVR output. The cycles per
+// bit are measured by begin() on the loops as built (see measureLoops()
+// and _ss_loop_cycles() below), so _SS_RX_BIT_CYCLES and _SS_TX_BIT_CYCLES
+// only apply when TCA0 is not available for that. The start and stop
+// figures can be checked by setting _DEBUG in SoftwareSerial.cpp: each
+// sample in recv() then pulses _DEBUG_PIN2. Any figure can be overridden
+// in the build flags.
+//
+#if GCC_VERSION > 40800
+// Counted from gcc 4.8.2 output. From the start bit edge, there are 3 or
+// 4 cycles before the interrupt flag is set, 4 cycles to enter the
+// interrupt and 75 cycles of instructions until the first delay, which
+// make up the pin change entry path; then 17 more cycles until the first
+// data bit is read.
+#ifndef _SS_RX_EDGE_CYCLES
+#define _SS_RX_EDGE_CYCLES (4 + 4 + 75)
+#endif
+#ifndef _SS_RX_START_CYCLES
+#define _SS_RX_START_CYCLES (_SS_RX_EDGE_CYCLES + 17)
+#endif
+// Cycles per bit in the receive loop, counted before it kept a 16-bit
+// shift register and the running parity; begin() measures the current
+// loop instead
+#ifndef _SS_RX_BIT_CYCLES
+#define _SS_RX_BIT_CYCLES 23
+#endif
+// 37 cycles from the last bit read to the stop bit delay, and 11 cycles
+// from there until the interrupt mask is enabled again
+#ifndef _SS_RX_STOP_CYCLES
+#define _SS_RX_STOP_CYCLES (37 + 11)
+#endif
+#else
+// Counted from gcc 4.3.2 output, which is a lot slower mostly due to bad
+// register allocation choices
+#ifndef _SS_RX_EDGE_CYCLES
+#define _SS_RX_EDGE_CYCLES (4 + 4 + 97)
+#endif
+#ifndef _SS_RX_START_CYCLES
+#define _SS_RX_START_CYCLES (_SS_RX_EDGE_CYCLES + 29)
+#endif
+#ifndef _SS_RX_BIT_CYCLES
+#define _SS_RX_BIT_CYCLES 11
+#endif
+#ifndef _SS_RX_STOP_CYCLES
+#define _SS_RX_STOP_CYCLES (44 + 17)
+#endif
+#endif
+// The port interrupt handler tests the pins below the receive pin first.
+// Not measured yet, so the start bit model leaves it out.
+#ifndef _SS_RX_PIN_CYCLES
+#define _SS_RX_PIN_CYCLES 0
+#endif
+// 12 to 16 cycles per bit depending on the compiler, counted before the
+// loop tested for the parity slot. These are all close enough to just use
+// 15 cycles, since the inter-bit timings are the most critical
+// (deviations stack 8 times). begin() measures the current loop instead.
+#ifndef _SS_TX_BIT_CYCLES
+#define _SS_TX_BIT_CYCLES 15
+#endif
+
+// Number of tunedDelay() counts that together with the given overhead
+// make up num / speed CPU cycles, rounded to nearest rather than
+// truncated so the error does not stack up per bit. Never less than 1.
+static constexpr uint16_t _ss_delay(uint32_t num, uint32_t speed, uint16_t overhead)
+{
+  return num > (overhead + 2UL) * speed ? (num - overhead * speed + 2 * speed) / (4 * speed) : 1;
+}
+
+// Cycles per bit of a loop outside its delay, from the TCA0 ticks of 64
+// CPU cycles taken by 16 calls of the loop for 16 bits and 16 calls for 1
+// bit. The 240 bits in between each include a delay of 1 count, which
+// the model above takes as 4 cycles. Rounded to nearest.
+static constexpr int16_t _ss_loop_cycles(uint16_t ticks_long, uint16_t ticks_short)
+{
+  return (((int32_t)ticks_long - ticks_short) * 64 + 120) / 240 - 4;
+}
+
+#endif
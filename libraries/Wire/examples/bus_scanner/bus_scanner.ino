@@ -0,0 +1,59 @@
+// Wire Bus Scanner
+
+// Demonstrates the Wire library diagnostics
+// Lists the devices answering on the I2C/TWI bus, then traces the
+// transactions made to the first one, with their timing and result
+
+// This example code is in the public domain.
+
+
+#include <Wire.h>
+
+uint8_t found[16];
+TWI_TRACE_t trace[8];
+
+void setup() {
+  Wire.begin();        // join i2c bus (address optional for master)
+  Serial.begin(9600);  // start serial for output
+  Wire.startTrace(trace, 8);
+}
+
+void loop() {
+  Wire.startScan(found);
+  while (Wire.scanning()) {
+    // free to do something else meanwhile
+  }
+
+  int first = -1;
+  for (uint8_t address = 0x08; address <= 0x77; address++) {
+    if (Wire.scanFound(found, address)) {
+      Serial.print("device at 0x");
+      Serial.println(address, HEX);
+      if (first < 0) {
+        first = address;
+      }
+    }
+  }
+
+  if (first >= 0) {
+    Wire.requestFrom(first, 2);
+    while (Wire.available()) {
+      Wire.read();
+    }
+  }
+
+  TWI_TRACE_t entry;
+  while (Wire.readTrace(&entry)) {
+    Serial.print(entry.timestamp);
+    Serial.print(" us: 0x");
+    Serial.print(entry.address, HEX);
+    Serial.print((entry.direction & TWI_TRACE_READ) ? " read " : " write ");
+    Serial.print(entry.length);
+    Serial.print(" bytes in ");
+    Serial.print(entry.duration);
+    Serial.print(" us, result ");
+    Serial.println(entry.result);
+  }
+
+  delay(5000);
+}
@@ -0,0 +1,37 @@
+// Wire Slave Registers
+
+// Demonstrates use of the Wire library
+// Exposes a block of memory as I2C/TWI slave registers, the way most
+// sensors do. The master writes a register number, then reads or writes
+// consecutive registers starting there. No callbacks are involved.
+
+// This example code is in the public domain.
+
+
+#include <Wire.h>
+
+struct Registers {
+  uint8_t id;          // register 0, read only
+  uint8_t control;     // register 1
+  uint16_t counter;    // registers 2-3, read only
+};
+
+Registers regs = { 0x42, 0, 0 };
+
+// one bit per register, set for registers the master cannot write
+const uint8_t readOnly[] = { 0b00001101 };
+
+void setup() {
+  Wire.begin(8);                                  // join i2c bus with address #8
+  Wire.setRegisterFile(&regs, sizeof(regs), readOnly);
+  pinMode(LED_BUILTIN, OUTPUT);
+}
+
+void loop() {
+  noInterrupts();                                 // keep the 16 bit value consistent
+  regs.counter++;
+  interrupts();
+
+  digitalWrite(LED_BUILTIN, regs.control & 1);    // written by the master
+  delay(100);
+}
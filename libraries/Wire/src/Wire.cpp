@@ -33,15 +33,20 @@ extern "C" {
 
 // Initialize Class Variables //////////////////////////////////////////////////
 
-uint8_t TwoWire::rxBuffer[BUFFER_LENGTH];
+uint8_t TwoWire::rxBuffer[WIRE_RX_BUFFER_LENGTH];
 uint8_t TwoWire::rxBufferIndex = 0;			//head
 uint8_t TwoWire::rxBufferLength = 0;		//tail
 
 uint8_t TwoWire::txAddress = 0;
-uint8_t TwoWire::txBuffer[BUFFER_LENGTH];
+uint8_t TwoWire::txBuffer[WIRE_TX_BUFFER_LENGTH];
 uint8_t TwoWire::txBufferIndex = 0;			//head
 uint8_t TwoWire::txBufferLength = 0;		//tail
 
+uint8_t* TwoWire::slaveRxBuffer = TwoWire::rxBuffer;
+uint8_t* TwoWire::slaveTxBuffer = TwoWire::txBuffer;
+uint8_t TwoWire::slaveTxBufferLength = 0;
+uint8_t TwoWire::slaveRequesting = 0;
+
 uint8_t TwoWire::transmitting = 0;
 void (*TwoWire::user_onRequest)(void);
 void (*TwoWire::user_onReceive)(int);
@@ -63,8 +68,15 @@ void TwoWire::begin(void)
 	txBufferLength = 0;
 
 	TWI_MasterInit(DEFAULT_FREQUENCY);	
+
+	// slave started first, now running in dual mode
+	if(TWI_DualModeEnabled()){
+		attachSlaveBuffers();
+	}
 }
 
+// Calling both begin() and begin(address) runs master and slave at the
+// same time (dual mode). The slave then answers on the alternate TWI pins.
 void TwoWire::begin(uint8_t address)
 {
 	rxBufferIndex = 0;
@@ -75,9 +87,7 @@ void TwoWire::begin(uint8_t address)
   
 	TWI_SlaveInit(address);
 	
-	TWI_attachSlaveTxEvent(onRequestService, txBuffer); // default callback must exist
-	TWI_attachSlaveRxEvent(onReceiveService, rxBuffer, BUFFER_LENGTH); // default callback must exist
-	
+	attachSlaveBuffers();
 }
 
 void TwoWire::begin(int address)
@@ -88,18 +98,117 @@ void TwoWire::begin(int address)
 void TwoWire::end(void)
 {
 	TWI_Disable();
+
+	if(slaveRxBuffer != rxBuffer){
+		free(slaveRxBuffer);
+		free(slaveTxBuffer);
+		slaveRxBuffer = rxBuffer;
+		slaveTxBuffer = txBuffer;
+	}
 }
 
+// Any frequency up to 1MHz (Fast-mode Plus) is accepted, the closest
+// achievable clock not above it is used. See getClock().
 void TwoWire::setClock(uint32_t clock)
 {
 	TWI_MasterSetBaud(clock);
 }
 
+// returns the SCL frequency actually generated
+uint32_t TwoWire::getClock(void)
+{
+	return TWI_MasterFrequency();
+}
+
+// sets the SCL rise time in ns used when computing the clock, which
+// depends on bus capacitance and pull-ups. 0 selects the I2C maximum
+// for the selected speed (1000ns/300ns/120ns).
+void TwoWire::setRiseTime(uint16_t t_rise_ns)
+{
+	TWI_MasterSetRiseTime(t_rise_ns);
+}
+
+// Sets the timeout of master transactions in microseconds, 0 disables it.
+// It limits each transaction as a whole, not each byte. When
+// reset_with_timeout is set, a timed out transaction also clocks out
+// any slave holding SDA low and sends a STOP to free the bus.
+void TwoWire::setWireTimeout(uint32_t timeout, bool reset_with_timeout)
+{
+	TWI_MasterClearTimeoutFlag();
+	TWI_MasterSetTimeout(timeout, reset_with_timeout);
+}
+
+bool TwoWire::getWireTimeoutFlag(void)
+{
+	return TWI_MasterTimeoutFlag();
+}
+
+void TwoWire::clearWireTimeoutFlag(void)
+{
+	TWI_MasterClearTimeoutFlag();
+}
+
+// Error code of the last master transaction, using the same values as
+// endTransmission(). Mostly useful after requestFrom(), which returns the
+// number of bytes read instead.
+uint8_t TwoWire::lastError(void)
+{
+	return TWI_MasterError();
+}
+
+// uses the SMBus bus idle timeout (50us) instead of the I2C one, and
+// limits the transaction timeout of setWireTimeout() to 35ms
+void TwoWire::setSMBus(bool enable)
+{
+	TWI_MasterSetSMBus(enable);
+}
+
+// enables SMBus packet error checking for all master transactions: a PEC
+// byte is appended to endTransmission() and expected after the data of
+// requestFrom(), which then returns 0 and sets lastError() to 8 on mismatch
+void TwoWire::setPEC(bool enable)
+{
+	TWI_MasterSetPEC(enable);
+}
+
+// SMBus quick command, returns 0 if the device acknowledged its address
+uint8_t TwoWire::quickCommand(uint8_t address, bool read)
+{
+	return TWI_MasterQuickCommand(address, read);
+}
+
+// SMBus block write: command code, byte count, then the data.
+// Returns the same codes as endTransmission()
+uint8_t TwoWire::blockWrite(uint8_t address, uint8_t command, const uint8_t *data, uint8_t count)
+{
+	if(count > WIRE_TX_BUFFER_LENGTH - 2){
+		return TWIM_ERROR_DATA_TOO_LONG;
+	}
+
+	beginTransmission(address);
+	write(command);
+	write(count);
+	write(data, count);
+	return endTransmission(true);
+}
+
+// SMBus block read into buffer, returns the byte count sent by the device
+// or 0 on error, see lastError()
+uint8_t TwoWire::blockRead(uint8_t address, uint8_t command, uint8_t *buffer, uint8_t size)
+{
+	return TWI_MasterBlockRead(address, command, buffer, size);
+}
+
 uint8_t TwoWire::requestFrom(uint8_t address, size_t quantity, bool sendStop) {	
-	if(quantity > BUFFER_LENGTH){
-		quantity = BUFFER_LENGTH;
+	if(quantity > WIRE_RX_BUFFER_LENGTH){
+		quantity = WIRE_RX_BUFFER_LENGTH;
 	}
 	
+	/* Mark the rx buffer as in use, so slave data received meanwhile
+	 * in dual mode does not overwrite it */
+	rxBufferIndex = 0;
+	rxBufferLength = quantity;
+
 	uint8_t bytes_read = TWI_MasterRead(address, rxBuffer, quantity, sendStop);
 	
 	/* Initialize read variables */
@@ -109,6 +218,20 @@ uint8_t TwoWire::requestFrom(uint8_t address, size_t quantity, bool sendStop) {
 	return bytes_read;
 }
 
+// reads directly into the caller's memory, without the rx buffer size
+// limit. The data is not available through read()
+size_t TwoWire::requestFrom(uint8_t address, uint8_t *buffer, size_t quantity, bool sendStop)
+{
+	if(quantity == 0){
+		return 0;
+	}
+	if(quantity > 0xFFFF){
+		quantity = 0xFFFF;
+	}
+
+	return TWI_MasterRead(address, buffer, quantity, sendStop);
+}
+
 uint8_t TwoWire::requestFrom(uint8_t address, size_t quantity)
 {
 	return requestFrom(address, quantity, true);
@@ -168,6 +291,11 @@ uint8_t TwoWire::endTransmission(bool sendStop)
 	return status;
 }
 
+//	Returns 0 on success, otherwise one of:
+//	  2 address NACK, 3 data NACK, 4 other error, 5 timeout,
+//	  6 bus held low after timeout, 7 arbitration lost after retries,
+//	  8 SMBus PEC mismatch
+//
 //	This provides backwards compatibility with the original
 //	definition, and expected behaviour, of endTransmission
 //
@@ -181,8 +309,19 @@ uint8_t TwoWire::endTransmission(void)
 // or after beginTransmission(address)
 size_t TwoWire::write(uint8_t data)
 {
+	/* Slave replies have their own buffer in dual mode, a master
+	 * transmission may be in progress */
+	if(slaveRequesting && (slaveTxBuffer != txBuffer)){
+		if(slaveTxBufferLength >= WIRE_TX_BUFFER_LENGTH){
+			setWriteError();
+			return 0;
+		}
+		slaveTxBuffer[slaveTxBufferLength++] = data;
+		return 1;
+	}
+
 	/* Check if buffer is full */
-	if(txBufferLength >= BUFFER_LENGTH){
+	if(txBufferLength >= WIRE_TX_BUFFER_LENGTH){
 	  setWriteError();
 	  return 0;
 	}
@@ -282,6 +421,11 @@ void TwoWire::onReceiveService(int numBytes)
 		return;
 	}
 
+	// in dual mode data arrives in the slave buffer
+	if(slaveRxBuffer != rxBuffer){
+		memcpy(rxBuffer, slaveRxBuffer, numBytes);
+	}
+
 	// set rx iterator vars
 	rxBufferIndex = 0;
 	rxBufferLength = numBytes;
@@ -298,6 +442,15 @@ uint8_t TwoWire::onRequestService(void)
 		return 0;
 	}
 	
+	// dual mode, reply through the slave buffer
+	if(slaveTxBuffer != txBuffer){
+		slaveTxBufferLength = 0;
+		slaveRequesting = 1;
+		user_onRequest();
+		slaveRequesting = 0;
+		return slaveTxBufferLength;
+	}
+
 	// reset slave write buffer iterator var
 	txBufferIndex = 0;
 	txBufferLength = 0;
@@ -308,6 +461,28 @@ uint8_t TwoWire::onRequestService(void)
 	return txBufferLength;
 }
 
+// hands the slave buffers to the TWI driver. When master and slave run
+// together (dual mode) the slave gets its own buffers, allocated on first
+// use so that single mode applications do not pay for them
+void TwoWire::attachSlaveBuffers(void)
+{
+	if(TWI_DualModeEnabled() && (slaveRxBuffer == rxBuffer)){
+		uint8_t* rx = (uint8_t*)malloc(WIRE_RX_BUFFER_LENGTH);
+		uint8_t* tx = (uint8_t*)malloc(WIRE_TX_BUFFER_LENGTH);
+		if(rx && tx){
+			slaveRxBuffer = rx;
+			slaveTxBuffer = tx;
+		} else {
+			// out of memory, keep sharing the master buffers
+			free(rx);
+			free(tx);
+		}
+	}
+
+	TWI_attachSlaveTxEvent(onRequestService, slaveTxBuffer); // default callback must exist
+	TWI_attachSlaveRxEvent(onReceiveService, slaveRxBuffer, WIRE_RX_BUFFER_LENGTH); // default callback must exist
+}
+
 // sets function called on slave write
 void TwoWire::onReceive( void (*function)(int) )
 {
@@ -320,6 +495,65 @@ void TwoWire::onRequest( void (*function)(void) )
 	user_onRequest = function;
 }
 
+// starts probing addresses first..last without blocking. found must hold
+// 16 bytes, use scanFound() once scanning() returns false
+bool TwoWire::startScan(uint8_t *found, uint8_t first, uint8_t last)
+{
+	return TWI_MasterScanStart(found, first, last);
+}
+
+bool TwoWire::scanning(void)
+{
+	return TWI_MasterScanBusy();
+}
+
+// records every master transaction (address, direction, length, result,
+// start time and duration) in a ring buffer of depth entries
+void TwoWire::startTrace(TWI_TRACE_t *buffer, uint8_t depth)
+{
+	TWI_TraceStart(buffer, depth);
+}
+
+void TwoWire::stopTrace(void)
+{
+	TWI_TraceStart(NULL, 0);
+}
+
+// gets the oldest recorded transaction, false if there is none
+bool TwoWire::readTrace(TWI_TRACE_t *entry)
+{
+	return TWI_TraceRead(entry);
+}
+
+// serves a memory region as slave registers directly from the TWI
+// interrupt, see TWI_SlaveSetRegisterFile(). onReceive/onRequest are
+// not called while it is set, pass NULL to return to them
+void TwoWire::setRegisterFile(void *registers, uint16_t size, const uint8_t *readOnly)
+{
+	TWI_SlaveSetRegisterFile((uint8_t*)registers, size, readOnly);
+}
+
+// makes the slave also answer to a second address, 0 disables it.
+// Call after begin(address)
+void TwoWire::setSecondAddress(uint8_t address)
+{
+	TWI_SlaveSetSecondAddress(address);
+}
+
+// makes the slave answer to every address matching begin(address) on the
+// bits cleared in mask. Replaces a second address
+void TwoWire::setAddressMask(uint8_t mask)
+{
+	TWI_SlaveSetAddressMask(mask);
+}
+
+// address the master used, for use in onReceive/onRequest callbacks when
+// answering to several addresses
+uint8_t TwoWire::getIncomingAddress(void)
+{
+	return TWI_SlaveMatchedAddress();
+}
+
 // Preinstantiate Objects //////////////////////////////////////////////////////
 
 TwoWire Wire = TwoWire();
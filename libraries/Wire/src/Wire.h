@@ -24,11 +24,34 @@
 
 #include <Arduino.h>
 
-#define BUFFER_LENGTH 128
+#include "utility/twi_trace.h"
+
+// Buffer sizes (up to 255) can be set per build to save RAM, e.g. with
+// -DWIRE_BUFFER_LENGTH=32 in compiler.cpp.extra_flags. Reads longer than
+// the buffer can go straight to user memory with
+// requestFrom(address, buffer, quantity).
+#ifndef WIRE_BUFFER_LENGTH
+#define WIRE_BUFFER_LENGTH 128
+#endif
+#ifndef WIRE_RX_BUFFER_LENGTH
+#define WIRE_RX_BUFFER_LENGTH WIRE_BUFFER_LENGTH
+#endif
+#ifndef WIRE_TX_BUFFER_LENGTH
+#define WIRE_TX_BUFFER_LENGTH WIRE_BUFFER_LENGTH
+#endif
+#if (WIRE_RX_BUFFER_LENGTH > 255) || (WIRE_TX_BUFFER_LENGTH > 255)
+#error "Wire buffers are limited to 255 bytes"
+#endif
+
+#define BUFFER_LENGTH WIRE_RX_BUFFER_LENGTH
 
 // WIRE_HAS_END means Wire has end()
 #define WIRE_HAS_END 1
 
+// WIRE_HAS_TIMEOUT means Wire has setWireTimeout(), getWireTimeoutFlag
+// and clearWireTimeoutFlag()
+#define WIRE_HAS_TIMEOUT 1
+
 class TwoWire : public HardwareI2C
 {
   private:
@@ -41,11 +64,18 @@ class TwoWire : public HardwareI2C
     static uint8_t txBufferIndex;
     static uint8_t txBufferLength;
 
+    // slave buffers, separate from the master ones only in dual mode
+    static uint8_t* slaveRxBuffer;
+    static uint8_t* slaveTxBuffer;
+    static uint8_t slaveTxBufferLength;
+    static uint8_t slaveRequesting;
+
     static uint8_t transmitting;
     static void (*user_onRequest)(void);
     static void (*user_onReceive)(int);
     static uint8_t onRequestService(void);
     static void onReceiveService(int);
+    static void attachSlaveBuffers(void);
   public:
     TwoWire();
     void begin();
@@ -53,6 +83,27 @@ class TwoWire : public HardwareI2C
     void begin(int);
     void end();
     void setClock(uint32_t);
+    uint32_t getClock(void);
+    void setRiseTime(uint16_t);
+    void setWireTimeout(uint32_t timeout = 25000, bool reset_with_timeout = true);
+    bool getWireTimeoutFlag(void);
+    void clearWireTimeoutFlag(void);
+    uint8_t lastError(void);
+
+    // SMBus
+    void setSMBus(bool);
+    void setPEC(bool);
+    uint8_t quickCommand(uint8_t, bool);
+    uint8_t blockWrite(uint8_t, uint8_t, const uint8_t *, uint8_t);
+    uint8_t blockRead(uint8_t, uint8_t, uint8_t *, uint8_t);
+
+    // Diagnostics
+    bool startScan(uint8_t *, uint8_t = 0x08, uint8_t = 0x77);
+    bool scanning(void);
+    static inline bool scanFound(const uint8_t *found, uint8_t address) { return found[address >> 3] & (1 << (address & 7)); }
+    void startTrace(TWI_TRACE_t *, uint8_t);
+    void stopTrace(void);
+    bool readTrace(TWI_TRACE_t *);
     void beginTransmission(uint8_t);
     void beginTransmission(int);
     uint8_t endTransmission(void);
@@ -61,6 +112,7 @@ class TwoWire : public HardwareI2C
     uint8_t requestFrom(uint8_t, size_t, bool);
     uint8_t requestFrom(int, int);
     uint8_t requestFrom(int, int, int);
+    size_t requestFrom(uint8_t, uint8_t *, size_t, bool = true);
     virtual size_t write(uint8_t);
     virtual size_t write(const uint8_t *, size_t);
     virtual int available(void);
@@ -69,6 +121,10 @@ class TwoWire : public HardwareI2C
     virtual void flush(void);
     void onReceive( void (*)(int) );
     void onRequest( void (*)(void) );
+    void setRegisterFile(void *, uint16_t, const uint8_t * = NULL);
+    void setSecondAddress(uint8_t);
+    void setAddressMask(uint8_t);
+    uint8_t getIncomingAddress(void);
 
     inline size_t write(unsigned long n) { return write((uint8_t)n); }
     inline size_t write(long n) { return write((uint8_t)n); }
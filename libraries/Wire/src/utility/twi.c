@@ -27,13 +27,39 @@
 static register8_t  master_slaveAddress;                       /*!< Slave address */
 static register8_t* master_writeData;                          /*!< Data to write */
 static register8_t* master_readData;                           /*!< Read data */
-static register8_t  master_bytesToWrite;                       /*!< Number of bytes to write */
-static register8_t  master_bytesToRead;                        /*!< Number of bytes to read */
-static register8_t  master_bytesWritten;                       /*!< Number of bytes written */
-static register8_t  master_bytesRead;                          /*!< Number of bytes read */
+static volatile uint16_t master_bytesToWrite;                   /*!< Number of bytes to write */
+static volatile uint16_t master_bytesToRead;                    /*!< Number of bytes to read */
+static volatile uint16_t master_bytesWritten;                   /*!< Number of bytes written */
+static volatile uint16_t master_bytesRead;                      /*!< Number of bytes read */
 static register8_t  master_sendStop;                           /*!< To send a stop at the end of the transaction or not */
 static register8_t  master_trans_status;                       /*!< Status of transaction */
 static register8_t  master_result;                             /*!< Result of transaction */
+static uint32_t     master_timeout = TWI_MASTER_DEFAULT_TIMEOUT; /*!< Transaction timeout in us in use, 0 if disabled */
+static uint32_t     master_userTimeout = TWI_MASTER_DEFAULT_TIMEOUT; /*!< Transaction timeout set by TWI_MasterSetTimeout() */
+static uint8_t      master_smbus;                              /*!< SMBus timeouts in use */
+static uint8_t      master_recoverBus = 1;                     /*!< Clock out a stuck slave on timeout */
+static register8_t  master_timeoutFlag;                        /*!< Set when a transaction timed out */
+static uint32_t     master_frequency;                          /*!< Requested SCL frequency */
+static uint16_t     master_riseTime;                           /*!< SCL rise time in ns, 0 for default */
+static uint8_t      master_busTimeout = TWI_TIMEOUT_200US_gc;  /*!< Inactive bus timeout setting */
+static uint8_t      master_pec;                                /*!< SMBus packet error checking enabled */
+static register8_t  master_crc;                                /*!< Running PEC of the transaction */
+static register8_t  master_pecPending;                         /*!< PEC byte still to be sent or received */
+static register8_t  master_lengthPending;                      /*!< Next byte read is an SMBus block count */
+static register8_t  master_quickRead;                          /*!< SMBus quick command with R/_W = 1 */
+
+/* Bus scan */
+static register8_t  scan_active;                               /*!< Scan in progress, owns the master */
+static register8_t  scan_address;                              /*!< Address being probed */
+static uint8_t      scan_last;                                 /*!< Last address to probe */
+static uint8_t*     scan_found;                                /*!< Bit map of acknowledged addresses */
+static uint32_t     scan_start;                                /*!< micros() when the scan started */
+
+/* Transaction trace */
+static TWI_TRACE_t* trace_buffer;                              /*!< Ring buffer, NULL when tracing is off */
+static uint8_t      trace_depth;                               /*!< Number of entries in the ring buffer */
+static uint8_t      trace_head;                                /*!< Next entry to write */
+static uint8_t      trace_count;                               /*!< Number of unread entries */
 
 /* Slave variables */
 static uint8_t (*TWI_onSlaveTransmit)(void) __attribute__((unused));
@@ -49,8 +75,25 @@ static register8_t  slave_result;
 static register8_t  slave_callUserReceive;
 static register8_t  slave_callUserRequest;
 
-/* TWI module mode */
-static volatile TWI_MODE_t twi_mode;
+/* Slave register file */
+static uint8_t*       slave_regFile;                           /*!< Registers served directly by the ISR, NULL if unused */
+static uint16_t       slave_regSize;                           /*!< Number of registers */
+static const uint8_t* slave_regReadOnly;                       /*!< One bit per register set if read only, NULL if all writable */
+static volatile uint16_t slave_regPointer;                     /*!< Current register, auto-incremented, 16 bits so that it ends after register 255 instead of wrapping */
+static register8_t    slave_regPointerPending;                 /*!< Next byte written by the master is the register pointer */
+
+static register8_t  slave_matchedAddress;                      /*!< Address the master used in the current transaction */
+
+/* TWI module mode, master and slave can be active at the same time in dual mode */
+static volatile TWI_MODE_t master_mode;
+static volatile TWI_MODE_t slave_mode;
+
+static void TWI_EnableDualMode(void);
+static void TWI_MasterTimeoutHandler(void);
+static void TWI_MasterUpdateTimeout(void);
+static void TWI_TraceRecord(uint8_t address, uint8_t direction, uint16_t length, uint32_t timestamp);
+static uint16_t TWI_MasterTransfer(uint8_t slave_address, uint8_t *write_data, uint16_t bytes_to_write,
+                                   uint16_t bytes_to_read, uint8_t send_stop, uint8_t smbus);
 
 /*! \brief Initialize the TWI module as a master.
  *
@@ -62,7 +105,7 @@ static volatile TWI_MODE_t twi_mode;
  */
 void TWI_MasterInit(uint32_t frequency)
 {
-	if(twi_mode != TWI_MODE_UNKNOWN) return;
+	if(master_mode != TWI_MODE_UNKNOWN) return;
 	
 	// Enable pullups just in case, should have external ones though
 #ifdef NO_EXTERNAL_I2C_PULLUP
@@ -71,14 +114,20 @@ void TWI_MasterInit(uint32_t frequency)
 #endif
 	PORTMUX.TWISPIROUTEA |= TWI_MUX;
 
-	twi_mode = TWI_MODE_MASTER;
+	/* Slave already running, move it to the dual mode pins */
+	if(slave_mode != TWI_MODE_UNKNOWN){
+		TWI_EnableDualMode();
+	}
+
+	master_mode = TWI_MODE_MASTER;
 	
 	master_bytesRead = 0;
 	master_bytesWritten = 0;
 	master_trans_status = TWIM_STATUS_READY;
 	master_result = TWIM_RESULT_UNKNOWN;
 	
-	TWI0.MCTRLA = TWI_RIEN_bm | TWI_WIEN_bm | TWI_ENABLE_bm;
+	/* Inactive bus timeout lets the bus state return to idle if SCL/SDA stop toggling */
+	TWI0.MCTRLA = TWI_RIEN_bm | TWI_WIEN_bm | master_busTimeout | TWI_ENABLE_bm;
 	TWI_MasterSetBaud(frequency);
 	TWI0.MSTATUS = TWI_BUSSTATE_IDLE_gc;
 }
@@ -94,9 +143,16 @@ void TWI_MasterInit(uint32_t frequency)
  */
 void TWI_SlaveInit(uint8_t address)
 {
-	if(twi_mode != TWI_MODE_UNKNOWN) return;
+	if(slave_mode != TWI_MODE_UNKNOWN) return;
 	
-	twi_mode = TWI_MODE_SLAVE;
+	PORTMUX.TWISPIROUTEA |= TWI_MUX;
+
+	/* Master already running, slave goes to the dual mode pins */
+	if(master_mode != TWI_MODE_UNKNOWN){
+		TWI0.DUALCTRL = TWI_ENABLE_bm;
+	}
+
+	slave_mode = TWI_MODE_SLAVE;
 	
 	slave_bytesRead = 0;
 	slave_bytesWritten = 0;
@@ -109,7 +165,67 @@ void TWI_SlaveInit(uint8_t address)
 	TWI0.SCTRLA = TWI_DIEN_bm | TWI_APIEN_bm | TWI_PIEN_bm  | TWI_ENABLE_bm;
 	
 	/* Bus Error Detection circuitry needs Master enabled to work */
-	TWI0.MCTRLA = TWI_ENABLE_bm;
+	if(master_mode == TWI_MODE_UNKNOWN){
+		TWI0.MCTRLA = TWI_ENABLE_bm;
+	}
+}
+
+/*! \brief Enable TWI dual mode.
+ *
+ *  In dual mode the master keeps the TWI_MUX pins while the slave moves to
+ *  the alternate pin pair of that mux setting (PC2/PC3 for the default
+ *  setting, PF2/PF3 for ALT1, PC6/PC7 for ALT2). The slave is disabled
+ *  while switching pins. Slave pins rely on the pull-ups of the bus they
+ *  are connected to.
+ */
+static void TWI_EnableDualMode(void)
+{
+	uint8_t sctrla = TWI0.SCTRLA;
+
+	TWI0.SCTRLA = sctrla & ~TWI_ENABLE_bm;
+	TWI0.DUALCTRL = TWI_ENABLE_bm;
+	TWI0.SCTRLA = sctrla;
+}
+
+/*! \brief Returns true if master and slave run simultaneously.
+ */
+uint8_t TWI_DualModeEnabled(void)
+{
+	return (TWI0.DUALCTRL & TWI_ENABLE_bm) ? 1 : 0;
+}
+
+/*! \brief Set a second TWI slave address.
+ *
+ *  The slave answers to both the address given to TWI_SlaveInit() and
+ *  this one. Replaces any address mask.
+ *
+ *  \param address				    Second 7 bit address, 0 to disable.
+ */
+void TWI_SlaveSetSecondAddress(uint8_t address)
+{
+	TWI0.SADDRMASK = address ? ((address << 1) | TWI_ADDREN_bm) : 0x00;
+}
+
+/*! \brief Set the TWI slave address mask.
+ *
+ *  Address bits set in the mask are ignored when matching, so the slave
+ *  answers to a range of addresses. Replaces any second address.
+ *
+ *  \param mask				    7 bit mask, 0 to match the address only.
+ */
+void TWI_SlaveSetAddressMask(uint8_t mask)
+{
+	TWI0.SADDRMASK = mask << 1;
+}
+
+/*! \brief Returns the address the master used for the current or last
+ *  slave transaction.
+ *
+ *  Can be called from the receive and transmit callbacks.
+ */
+uint8_t TWI_SlaveMatchedAddress(void)
+{
+	return slave_matchedAddress;
 }
 
 void TWI_Flush(void){
@@ -129,9 +245,13 @@ void TWI_Disable(void)
 	TWI0.MBAUD = 0x00;
 	TWI0.MSTATUS = TWI_BUSSTATE_IDLE_gc;
 	TWI0.SADDR = 0x00;
+	TWI0.SADDRMASK = 0x00;
 	TWI0.SCTRLA = 0x00;
+	TWI0.DUALCTRL = 0x00;
 
-	twi_mode = TWI_MODE_UNKNOWN;
+	master_frequency = 0;
+	master_mode = TWI_MODE_UNKNOWN;
+	slave_mode = TWI_MODE_UNKNOWN;
 }
 
 /*! \brief Returns the TWI bus state.
@@ -170,40 +290,307 @@ uint8_t TWI_MasterReady(void)
 	return twi_status;
 }
 
+/*! \brief Returns the SCL rise time in CLK_PER cycles.
+ *
+ *  Uses the rise time set by TWI_MasterSetRiseTime(), or the maximum rise
+ *  time allowed by the I2C specification for the given frequency.
+ */
+static uint16_t TWI_MasterRiseCycles(uint32_t frequency)
+{
+	uint16_t t_rise = master_riseTime;
+
+	if(t_rise == 0){
+		if(frequency <= 100000){
+			t_rise = 1000;
+		} else if(frequency <= 400000){
+			t_rise = 300;
+		} else {
+			t_rise = 120;
+		}
+	}
+
+	/* Kept in kHz to avoid overflowing 32 bits with F_CPU * t_rise */
+	return (uint16_t)(((F_CPU_CORRECTED / 1000) * t_rise + 500000) / 1000000);
+}
+
 /*! \brief Set the TWI baud rate.
  *
- *  Sets the baud rate used by TWI Master.
+ *  Sets the baud rate used by TWI Master. Any frequency is accepted, the
+ *  closest SCL frequency not above it is selected. Fast mode plus drive
+ *  strength is enabled from 400kHz.
  *
  *  \param frequency				    The required baud.
+ *
+ *  \retval The achieved SCL frequency.
  */
-void TWI_MasterSetBaud(uint32_t frequency){
+uint32_t TWI_MasterSetBaud(uint32_t frequency){
 
 //		Formula is: BAUD = ((F_CLKPER/frequency) - F_CLKPER*T_RISE - 10)/2;
 //		Where T_RISE varies depending on operating frequency...
 //			From 1617 DS: 1000ns @ 100kHz / 300ns @ 400kHz / 120ns @ 1MHz
 
-	uint16_t t_rise;
-	
-	if(frequency < 200000){
-		frequency = 100000;
-		t_rise = 1000;
-		
-	} else if (frequency < 800000){
-		frequency = 400000;
-		t_rise = 300;	
-
-	} else if (frequency < 1200000){
-		frequency = 1000000;
-		t_rise = 120;
-		
-	} else {
-		frequency = 100000;
-		t_rise = 1000;
+	if(frequency == 0) return TWI_MasterFrequency();
+
+	master_frequency = frequency;
+
+	/* Round the period up so the achieved frequency never exceeds the request */
+	int32_t cycles = (F_CPU_CORRECTED + frequency - 1) / frequency;
+	cycles -= 10 + TWI_MasterRiseCycles(frequency);
+
+	int32_t baud = (cycles + 1) / 2;
+	if(baud < 0) baud = 0;
+	if(baud > 255) baud = 255;
+
+	/* FMPEN must only be changed while the TWI is disabled */
+	uint8_t fmpen = (frequency >= 400000) ? TWI_FMPEN_bm : 0;
+	if((TWI0.CTRLA & TWI_FMPEN_bm) != fmpen){
+		uint8_t mctrla = TWI0.MCTRLA;
+		uint8_t sctrla = TWI0.SCTRLA;
+		TWI0.MCTRLA = mctrla & ~TWI_ENABLE_bm;
+		TWI0.SCTRLA = sctrla & ~TWI_ENABLE_bm;
+		TWI0.CTRLA = (TWI0.CTRLA & ~TWI_FMPEN_bm) | fmpen;
+		TWI0.SCTRLA = sctrla;
+		TWI0.MCTRLA = mctrla;
+		if(mctrla & TWI_ENABLE_bm){
+			TWI0.MSTATUS = TWI_BUSSTATE_IDLE_gc;
+		}
 	}
-	
-	uint32_t baud = ((F_CPU_CORRECTED/frequency) - (((F_CPU_CORRECTED*t_rise)/1000)/1000)/1000 - 10)/2;
+
 	TWI0.MBAUD = (uint8_t)baud;
 
+	return TWI_MasterFrequency();
+}
+
+/*! \brief Set the SCL rise time used in the baud rate calculation.
+ *
+ *  The rise time depends on bus capacitance and pull-up strength. The
+ *  current frequency is recalculated if the master is already set up.
+ *
+ *  \param t_rise_ns				    Rise time in ns, 0 for the I2C maximum.
+ */
+void TWI_MasterSetRiseTime(uint16_t t_rise_ns)
+{
+	master_riseTime = t_rise_ns;
+
+	if(master_frequency != 0){
+		TWI_MasterSetBaud(master_frequency);
+	}
+}
+
+/*! \brief Returns the SCL frequency resulting from the current MBAUD.
+ *
+ *  f_SCL = F_CLKPER / (10 + 2*BAUD + F_CLKPER*T_RISE)
+ */
+uint32_t TWI_MasterFrequency(void)
+{
+	uint32_t cycles = 10 + 2 * (uint32_t)TWI0.MBAUD + TWI_MasterRiseCycles(master_frequency);
+
+	return F_CPU_CORRECTED / cycles;
+}
+
+/*! \brief Set the TWI master transaction timeout.
+ *
+ *  The timeout applies to each transaction as a whole, from the START to
+ *  the last byte, not to each byte. A transaction not completed within it
+ *  is aborted, the TWI module is reset and, if requested, the bus is
+ *  recovered by clocking out any slave holding SDA low. With SMBus
+ *  timeouts in use, a timeout above the SMBus limit, or none, is cut down
+ *  to TWI_SMBUS_TIMEOUT.
+ *
+ *  \param timeout_us				    Timeout in microseconds, 0 to disable.
+ *  \param recover_bus				    Run TWI_MasterRecoverBus() on timeout.
+ */
+void TWI_MasterSetTimeout(uint32_t timeout_us, uint8_t recover_bus)
+{
+	master_userTimeout = timeout_us;
+	master_recoverBus = recover_bus;
+	TWI_MasterUpdateTimeout();
+}
+
+/*! \brief Select the transaction timeout in use from the one set and SMBus.
+ */
+static void TWI_MasterUpdateTimeout(void)
+{
+	if(master_smbus && (master_userTimeout == 0 || master_userTimeout > TWI_SMBUS_TIMEOUT)){
+		master_timeout = TWI_SMBUS_TIMEOUT;
+	}
+	else {
+		master_timeout = master_userTimeout;
+	}
+}
+
+/*! \brief Returns true if a transaction timed out since the flag was cleared.
+ */
+uint8_t TWI_MasterTimeoutFlag(void)
+{
+	return master_timeoutFlag;
+}
+
+/*! \brief Clear the transaction timeout flag.
+ */
+void TWI_MasterClearTimeoutFlag(void)
+{
+	master_timeoutFlag = 0;
+}
+
+/*! \brief Returns the error code of the last master transaction.
+ *
+ *  \retval TWIM_ERROR_t code, TWIM_ERROR_NONE if successful.
+ */
+uint8_t TWI_MasterError(void)
+{
+	switch(master_result){
+		case TWIM_RESULT_OK:               return TWIM_ERROR_NONE;
+		case TWIM_RESULT_ADDRESS_NACK:     return TWIM_ERROR_ADDRESS_NACK;
+		case TWIM_RESULT_NACK_RECEIVED:    return TWIM_ERROR_DATA_NACK;
+		case TWIM_RESULT_TIMEOUT:          return TWIM_ERROR_TIMEOUT;
+		case TWIM_RESULT_BUS_STUCK:        return TWIM_ERROR_BUS_STUCK;
+		case TWIM_RESULT_ARBITRATION_LOST: return TWIM_ERROR_ARBITRATION_LOST;
+		case TWIM_RESULT_PEC_ERROR:        return TWIM_ERROR_PEC;
+		default:                           return TWIM_ERROR_OTHER;
+	}
+}
+
+/*! \brief Free a bus held by a slave.
+ *
+ *  Takes SDA/SCL away from the TWI module and toggles SCL up to nine times
+ *  until the slave releases SDA, then generates a STOP condition. The TWI
+ *  master is re-enabled with the bus state forced to idle afterwards.
+ *
+ *  \retval true  If both SDA and SCL are released.
+ *  \retval false If the bus is still held low.
+ */
+uint8_t TWI_MasterRecoverBus(void)
+{
+	PORT_t* sda_port = digitalPinToPortStruct(PIN_WIRE_SDA);
+	PORT_t* scl_port = digitalPinToPortStruct(PIN_WIRE_SCL);
+	uint8_t sda_mask = digitalPinToBitMask(PIN_WIRE_SDA);
+	uint8_t scl_mask = digitalPinToBitMask(PIN_WIRE_SCL);
+
+	/* Release the pins from the TWI module */
+	uint8_t mctrla = TWI0.MCTRLA;
+	TWI0.MCTRLA = 0x00;
+
+	/* Open drain emulation: drive low through DIR, release as input */
+	sda_port->OUTCLR = sda_mask;
+	scl_port->OUTCLR = scl_mask;
+	sda_port->DIRCLR = sda_mask;
+	scl_port->DIRCLR = scl_mask;
+	delayMicroseconds(5);
+
+	for(uint8_t i = 0; (i < 9) && !(sda_port->IN & sda_mask); i++){
+		scl_port->DIRSET = scl_mask;
+		delayMicroseconds(5);
+		scl_port->DIRCLR = scl_mask;
+		delayMicroseconds(5);
+	}
+
+	/* STOP condition: SDA rising while SCL is high */
+	scl_port->DIRSET = scl_mask;
+	sda_port->DIRSET = sda_mask;
+	delayMicroseconds(5);
+	scl_port->DIRCLR = scl_mask;
+	delayMicroseconds(5);
+	sda_port->DIRCLR = sda_mask;
+	delayMicroseconds(5);
+
+	uint8_t released = (sda_port->IN & sda_mask) && (scl_port->IN & scl_mask);
+
+	TWI0.MCTRLA = mctrla;
+	TWI0.MSTATUS = TWI_BUSSTATE_IDLE_gc;
+
+	return released;
+}
+
+/*! \brief TWI master transaction timeout handler.
+ *
+ *  Aborts the ongoing transaction, resets the TWI master and recovers
+ *  the bus if enabled.
+ */
+static void TWI_MasterTimeoutHandler(void)
+{
+	uint8_t mctrla = TWI0.MCTRLA;
+	uint8_t result = TWIM_RESULT_TIMEOUT;
+
+	/* Disable master to stop further interrupts for this transaction */
+	TWI0.MCTRLA = 0x00;
+
+	if(master_recoverBus && !TWI_MasterRecoverBus()){
+		result = TWIM_RESULT_BUS_STUCK;
+	}
+
+	TWI0.MCTRLA = mctrla;
+	TWI0.MSTATUS = TWI_BUSSTATE_IDLE_gc;
+
+	master_timeoutFlag = 1;
+	TWI_MasterTransactionFinished(result);
+}
+
+/*! \brief Configure SMBus timeouts.
+ *
+ *  SMBus considers the bus idle after SCL and SDA have been high for 50us
+ *  and requires a transaction to be aborted when the clock is held low for
+ *  25-35ms. The transaction timeout of TWI_MasterSetTimeout() is kept if it
+ *  is shorter, else TWI_SMBUS_TIMEOUT is used. When disabled, the I2C bus
+ *  idle timeout and the transaction timeout set are used again.
+ *
+ *  \param enable				    Use SMBus timeouts.
+ */
+void TWI_MasterSetSMBus(uint8_t enable)
+{
+	master_busTimeout = enable ? TWI_TIMEOUT_50US_gc : TWI_TIMEOUT_200US_gc;
+	master_smbus = enable;
+	TWI_MasterUpdateTimeout();
+
+	/* TIMEOUT is changed with the master disabled */
+	uint8_t mctrla = TWI0.MCTRLA;
+	if(mctrla & TWI_ENABLE_bm){
+		TWI0.MCTRLA = mctrla & ~TWI_ENABLE_bm;
+		TWI0.MCTRLA = (mctrla & ~TWI_TIMEOUT_gm) | master_busTimeout;
+		TWI0.MSTATUS = TWI_BUSSTATE_IDLE_gc;
+	}
+}
+
+/*! \brief Enable SMBus packet error checking.
+ *
+ *  When enabled, a PEC byte is appended to master writes and expected after
+ *  the data of master reads. The CRC is updated in the interrupt handlers
+ *  as bytes go out or come in, a mismatch fails the read with
+ *  TWIM_RESULT_PEC_ERROR.
+ *
+ *  \param enable				    Use PEC.
+ */
+void TWI_MasterSetPEC(uint8_t enable)
+{
+	master_pec = enable;
+}
+
+/*! \brief SMBus CRC-8 (x^8 + x^2 + x + 1) of one more byte.
+ */
+static uint8_t TWI_Crc8(uint8_t crc, uint8_t data)
+{
+	crc ^= data;
+	for(uint8_t i = 0; i < 8; i++){
+		crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+	}
+	return crc;
+}
+
+/*! \brief Returns true if the transaction still has a read phase.
+ */
+static inline uint8_t TWI_MasterReadPending(void)
+{
+	return (master_bytesToRead > 0) || master_lengthPending || master_quickRead;
+}
+
+/*! \brief Sends an address byte, updating the PEC.
+ */
+static void TWI_MasterSendAddress(uint8_t address)
+{
+	if(master_pecPending){
+		master_crc = TWI_Crc8(master_crc, address);
+	}
+	TWI0.MADDR = address;
 }
 
 /*! \brief TWI write transaction.
@@ -220,7 +607,7 @@ void TWI_MasterSetBaud(uint32_t frequency){
  */
 uint8_t TWI_MasterWrite(uint8_t slave_address,
 					 uint8_t *write_data,
-					 uint8_t bytes_to_write,
+					 uint16_t bytes_to_write,
 					 uint8_t send_stop)
 {
 	return TWI_MasterWriteRead(slave_address, 
@@ -242,14 +629,14 @@ uint8_t TWI_MasterWrite(uint8_t slave_address,
  *  \retval true  If transaction could be started.
  *  \retval false If transaction could not be started.
  */
-uint8_t TWI_MasterRead(uint8_t slave_address,
+uint16_t TWI_MasterRead(uint8_t slave_address,
 					uint8_t* read_data,
-					uint8_t bytes_to_read,
+					uint16_t bytes_to_read,
 					uint8_t send_stop)
 {
 	master_readData = read_data;
 
-	uint8_t bytes_read = TWI_MasterWriteRead(slave_address, 
+	uint16_t bytes_read = TWI_MasterWriteRead(slave_address, 
 										  0, 
 										  0, 
 										  bytes_to_read,
@@ -273,78 +660,296 @@ uint8_t TWI_MasterRead(uint8_t slave_address,
  *  \retval true  If transaction could be started.
  *  \retval false If transaction could not be started.
  */
-uint8_t TWI_MasterWriteRead(uint8_t slave_address,
+uint16_t TWI_MasterWriteRead(uint8_t slave_address,
                          uint8_t *write_data,
-                         uint8_t bytes_to_write,
-                         uint8_t bytes_to_read,
+                         uint16_t bytes_to_write,
+                         uint16_t bytes_to_read,
 						 uint8_t send_stop)
 {
-	if(twi_mode != TWI_MODE_MASTER) return false;
+	return TWI_MasterTransfer(slave_address, write_data, bytes_to_write, bytes_to_read, send_stop, 0);
+}
+
+
+/*! \brief TWI master transaction, with SMBus options.
+ *
+ *  Same as TWI_MasterWriteRead(). With TWI_SMBUS_BLOCK the first byte read
+ *  is a byte count replacing bytes_to_read, which then gives the buffer
+ *  size. With TWI_SMBUS_QUICK_READ only the read address is sent.
+ */
+static uint16_t TWI_MasterTransfer(uint8_t slave_address,
+                         uint8_t *write_data,
+                         uint16_t bytes_to_write,
+                         uint16_t bytes_to_read,
+						 uint8_t send_stop,
+						 uint8_t smbus)
+{
+	/* Not enabled as master: fail as a write or read would, for
+	 * TWI_MasterError() too */
+	if(master_mode != TWI_MODE_MASTER){
+		master_result = TWIM_RESULT_FAIL;
+		return ((bytes_to_read > 0) || (smbus & TWI_SMBUS_BLOCK)) ? 0 : TWIM_ERROR_OTHER;
+	}
 
 	/*Initiate transaction if bus is ready. */
 	if (master_trans_status == TWIM_STATUS_READY) {
-		
-		master_trans_status = TWIM_STATUS_BUSY;
-		master_result = TWIM_RESULT_UNKNOWN;
+
+		uint8_t retries = TWI_MASTER_ARBITRATION_RETRIES;
+		uint32_t timestamp = micros();
 
 		master_writeData = write_data;
 
+		master_sendStop = send_stop;
+		master_slaveAddress = slave_address<<1;
+
+trigger_action:
+
+		master_trans_status = TWIM_STATUS_BUSY;
+		master_result = TWIM_RESULT_UNKNOWN;
+
 		master_bytesToWrite = bytes_to_write;
 		master_bytesToRead = bytes_to_read;
 		master_bytesWritten = 0;
 		master_bytesRead = 0;
-		master_sendStop = send_stop;
-		master_slaveAddress = slave_address<<1;
 
-trigger_action:
+		master_crc = 0;
+		master_lengthPending = (smbus & TWI_SMBUS_BLOCK) ? 1 : 0;
+		master_quickRead = (smbus & TWI_SMBUS_QUICK_READ) ? 1 : 0;
+		master_pecPending = (master_pec && !master_quickRead &&
+			(bytes_to_write || bytes_to_read || master_lengthPending)) ? 1 : 0;
 
 		/* If write command, send the START condition + Address +
 		 * 'R/_W = 0'
 		 */
 		if (master_bytesToWrite > 0) {
-			twi_mode = TWI_MODE_MASTER_TRANSMIT;
+			master_mode = TWI_MODE_MASTER_TRANSMIT;
 			uint8_t writeAddress = ADD_WRITE_BIT(master_slaveAddress);
-			TWI0.MADDR = writeAddress;
+			TWI_MasterSendAddress(writeAddress);
 		}
 
 		/* If read command, send the START condition + Address +
 		 * 'R/_W = 1'
 		 */
-		else if (master_bytesToRead > 0) {
-			twi_mode = TWI_MODE_MASTER_RECEIVE;
+		else if (TWI_MasterReadPending()) {
+			master_mode = TWI_MODE_MASTER_RECEIVE;
+			if (master_quickRead) {
+				/* Get RIF right after the address ACK, no data clocked */
+				TWI0.MCTRLA |= TWI_QCEN_bm;
+			}
 			uint8_t readAddress = ADD_READ_BIT(master_slaveAddress);
-			TWI0.MADDR = readAddress;
+			TWI_MasterSendAddress(readAddress);
 		}
 
 		else if (master_bytesToWrite == 0 && master_bytesToRead == 0) {
-			twi_mode = TWI_MODE_MASTER_TRANSMIT;
+			master_mode = TWI_MODE_MASTER_TRANSMIT;
 			uint8_t writeAddress = ADD_WRITE_BIT(master_slaveAddress);
-			TWI0.MADDR = writeAddress;
+			TWI_MasterSendAddress(writeAddress);
 		}
 
-		/* Arduino requires blocking function */
-		while(master_result == TWIM_RESULT_UNKNOWN) {}
+		/* Arduino requires blocking function, bounded by the timeout */
+		uint32_t start = micros();
+		while(master_result == TWIM_RESULT_UNKNOWN) {
+			if(master_timeout && ((micros() - start) > master_timeout)){
+				TWI_MasterTimeoutHandler();
+			}
+		}
 
-		// in case of arbitration lost, retry sending
-		if (master_result == TWIM_RESULT_ARBITRATION_LOST) {
+		// in case of arbitration lost, retry sending a limited number of times
+		if ((master_result == TWIM_RESULT_ARBITRATION_LOST) && (retries > 0)) {
+			retries--;
 			goto trigger_action;
 		}
 
-		uint8_t ret = 0;
-		if (master_bytesToRead > 0) {
-			// return bytes really read
-			ret = master_bytesRead;
+		if (trace_buffer) {
+			uint8_t direction = 0;
+			if ((bytes_to_read > 0) || (smbus & (TWI_SMBUS_BLOCK | TWI_SMBUS_QUICK_READ))) {
+				direction |= TWI_TRACE_READ;
+			}
+			if ((bytes_to_write > 0) || !direction) {
+				direction |= TWI_TRACE_WRITE;
+			}
+			TWI_TraceRecord(slave_address, direction, master_bytesWritten + master_bytesRead, timestamp);
+		}
+
+		uint16_t ret = 0;
+		if ((bytes_to_read > 0) || (smbus & TWI_SMBUS_BLOCK)) {
+			// return bytes really read, none if they failed the PEC
+			ret = (master_result == TWIM_RESULT_PEC_ERROR) ? 0 : master_bytesRead;
 		} else {
-			// return 0 if success, >0 otherwise
-			ret = (master_result == TWIM_RESULT_OK ? 0 : 1);
+			// return 0 if success, TWIM_ERROR_t code otherwise
+			ret = TWI_MasterError();
 		}
 
 		return ret;
 	} else {
-		return 1;
+		return (bytes_to_read > 0) ? 0 : TWIM_ERROR_OTHER;
+	}
+}
+
+
+/*! \brief SMBus block read.
+ *
+ *  Writes the command code, then reads the byte count sent by the slave
+ *  followed by that many bytes (and the PEC if enabled).
+ *
+ *  \param address        The slave address.
+ *  \param command        SMBus command code.
+ *  \param read_data      Buffer for the data, without the count.
+ *  \param size           Size of the buffer.
+ *
+ *  \retval Number of bytes read, 0 on error.
+ */
+uint8_t TWI_MasterBlockRead(uint8_t slave_address,
+                         uint8_t command,
+                         uint8_t *read_data,
+                         uint8_t size)
+{
+	master_readData = read_data;
+
+	return TWI_MasterTransfer(slave_address, &command, 1, size, 1, TWI_SMBUS_BLOCK);
+}
+
+/*! \brief SMBus quick command.
+ *
+ *  Sends only the slave address, the R/_W bit being the command.
+ *
+ *  \param address        The slave address.
+ *  \param read           Value of the R/_W bit.
+ *
+ *  \retval TWIM_ERROR_t code, TWIM_ERROR_NONE if acknowledged.
+ */
+uint8_t TWI_MasterQuickCommand(uint8_t slave_address, uint8_t read)
+{
+	TWI_MasterTransfer(slave_address, 0, 0, 0, 1, read ? TWI_SMBUS_QUICK_READ : 0);
+
+	return TWI_MasterError();
+}
+
+
+/*! \brief Start a non-blocking bus scan.
+ *
+ *  Probes each address with an address-only write, chaining the probes
+ *  with repeated STARTs from the master interrupt. Acknowledged addresses
+ *  are set in found, bit (address & 7) of byte (address >> 3), which must
+ *  hold 16 bytes. Other transactions are refused until the scan is over.
+ *
+ *  \param found          Bit map of responding addresses, cleared first.
+ *  \param first          First 7 bit address.
+ *  \param last           Last 7 bit address.
+ *
+ *  \retval true  If the scan was started.
+ *  \retval false If the master is not ready.
+ */
+uint8_t TWI_MasterScanStart(uint8_t *found, uint8_t first, uint8_t last)
+{
+	if((master_mode != TWI_MODE_MASTER) || (master_trans_status != TWIM_STATUS_READY)) return false;
+	if((first > last) || (last > 0x7F)) return false;
+
+	for(uint8_t i = 0; i < 16; i++){
+		found[i] = 0;
+	}
+
+	scan_found = found;
+	scan_address = first;
+	scan_last = last;
+	scan_start = micros();
+	scan_active = 1;
+
+	master_trans_status = TWIM_STATUS_BUSY;
+	master_result = TWIM_RESULT_UNKNOWN;
+	master_mode = TWI_MODE_MASTER_TRANSMIT;
+	TWI0.MADDR = ADD_WRITE_BIT(first << 1);
+
+	return true;
+}
+
+/*! \brief Returns true while a bus scan is running.
+ *
+ *  Also enforces the master timeout on the scan as a whole.
+ */
+uint8_t TWI_MasterScanBusy(void)
+{
+	if(scan_active && master_timeout && ((micros() - scan_start) > master_timeout)){
+		TWI_MasterTimeoutHandler();
+	}
+	return scan_active;
+}
+
+/*! \brief TWI master bus scan interrupt handler.
+ *
+ *  Records the (N)ACK of the probed address and addresses the next one.
+ */
+static void TWI_MasterScanHandler(uint8_t currentStatus)
+{
+	uint8_t address = scan_address;
+
+	if (!(currentStatus & TWI_RXACK_bm)) {
+		scan_found[address >> 3] |= (1 << (address & 7));
+	}
+
+	if (address < scan_last) {
+		scan_address = ++address;
+		TWI0.MADDR = ADD_WRITE_BIT(address << 1);
+	} else {
+		TWI0.MCTRLB = TWI_MCMD_STOP_gc;
+		TWI_MasterTransactionFinished(TWIM_RESULT_OK);
 	}
 }
 
+/*! \brief Start recording master transactions.
+ *
+ *  Each completed transaction is stored in a ring buffer supplied by the
+ *  application, overwriting the oldest entry when full. With no buffer the
+ *  cost of tracing is a single pointer test per transaction.
+ *
+ *  \param buffer         Ring buffer, NULL to stop tracing.
+ *  \param depth          Number of entries in the buffer.
+ */
+void TWI_TraceStart(TWI_TRACE_t *buffer, uint8_t depth)
+{
+	trace_buffer = depth ? buffer : 0;
+	trace_depth = depth;
+	trace_head = 0;
+	trace_count = 0;
+}
+
+/*! \brief Get the oldest unread trace entry.
+ *
+ *  \param entry          Copy of the entry.
+ *
+ *  \retval true  If an entry was copied.
+ *  \retval false If there is no unread entry.
+ */
+uint8_t TWI_TraceRead(TWI_TRACE_t *entry)
+{
+	if(!trace_buffer || !trace_count) return false;
+
+	uint8_t tail = trace_head + trace_depth - trace_count;
+	if(tail >= trace_depth) tail -= trace_depth;
+
+	*entry = trace_buffer[tail];
+	trace_count--;
+
+	return true;
+}
+
+/*! \brief Store a finished transaction in the trace buffer.
+ */
+static void TWI_TraceRecord(uint8_t address, uint8_t direction, uint16_t length, uint32_t timestamp)
+{
+	uint32_t duration = micros() - timestamp;
+	TWI_TRACE_t* entry = &trace_buffer[trace_head];
+
+	entry->timestamp = timestamp;
+	entry->duration = (duration > 0xFFFF) ? 0xFFFF : duration;
+	entry->length = length;
+	entry->address = address;
+	entry->direction = direction;
+	entry->result = TWI_MasterError();
+
+	if(++trace_head >= trace_depth) trace_head = 0;
+	if(trace_count < trace_depth) trace_count++;
+}
+
 
 /*! \brief Common TWI master interrupt service routine.
  *
@@ -362,6 +967,11 @@ void TWI_MasterInterruptHandler()
 		TWI_MasterArbitrationLostBusErrorHandler();
 	}
 
+	/* If probing addresses for a bus scan */
+	else if (scan_active) {
+		TWI_MasterScanHandler(currentStatus);
+	}
+
 	/* If master write interrupt. */
 	else if (currentStatus & TWI_WIF_bm) {
 		TWI_MasterWriteHandler();
@@ -387,21 +997,22 @@ void TWI_MasterArbitrationLostBusErrorHandler()
 {
 	uint8_t currentStatus = TWI0.MSTATUS;
 
+	uint8_t result;
+
 	/* If bus error. */
 	if (currentStatus & TWI_BUSERR_bm) {
-		master_result = TWIM_RESULT_BUS_ERROR;
+		result = TWIM_RESULT_BUS_ERROR;
 	}
 	/* If arbitration lost. */
 	else {
-		master_result = TWIM_RESULT_ARBITRATION_LOST;
+		result = TWIM_RESULT_ARBITRATION_LOST;
 	}
 
 	/* Clear all flags, abort operation */
 	TWI0.MSTATUS = currentStatus;
 
 	/* Wait for a new operation */	
-	twi_mode = TWI_MODE_MASTER;
-	master_trans_status = TWIM_STATUS_READY;
+	TWI_MasterTransactionFinished(result);
 }
 
 
@@ -413,18 +1024,21 @@ void TWI_MasterArbitrationLostBusErrorHandler()
 void TWI_MasterWriteHandler()
 {
 	/* Local variables used in if tests to avoid compiler warning. */
-	uint8_t bytesToWrite  = master_bytesToWrite;
-	uint8_t bytesToRead   = master_bytesToRead;
+	uint16_t bytesToWrite = master_bytesToWrite;
 
 	/* If NOT acknowledged (NACK) by slave cancel the transaction. */
 	if (TWI0.MSTATUS & TWI_RXACK_bm) {
+		/* NACK on the address if no data went out yet or a read address was sent */
+		uint8_t result = ((master_bytesWritten == 0) || (master_mode == TWI_MODE_MASTER_RECEIVE)) ?
+			TWIM_RESULT_ADDRESS_NACK : TWIM_RESULT_NACK_RECEIVED;
+
 		if(master_sendStop){
 			TWI0.MCTRLB = TWI_MCMD_STOP_gc;
 		} else {
 			TWI0.MCTRLB = TWI_MCMD_REPSTART_gc;
 
 		}
-		TWI_MasterTransactionFinished(TWIM_RESULT_NACK_RECEIVED);
+		TWI_MasterTransactionFinished(result);
 	}
 
 	/* If more bytes to write, send data. */
@@ -432,15 +1046,24 @@ void TWI_MasterWriteHandler()
 		uint8_t data = master_writeData[master_bytesWritten];
 		TWI0.MDATA = data;
 		master_bytesWritten++;
+		if (master_pecPending) {
+			master_crc = TWI_Crc8(master_crc, data);
+		}
 	}
 
 	/* If bytes to read, send START condition + Address +
 	 * 'R/_W = 1'
 	 */
-	else if (master_bytesRead < bytesToRead) {
-		twi_mode = TWI_MODE_MASTER_RECEIVE;
+	else if (TWI_MasterReadPending()) {
+		master_mode = TWI_MODE_MASTER_RECEIVE;
 		uint8_t readAddress = ADD_READ_BIT(master_slaveAddress);
-		TWI0.MADDR = readAddress;
+		TWI_MasterSendAddress(readAddress);
+	}
+
+	/* End of a write, append the PEC */
+	else if (master_pecPending) {
+		TWI0.MDATA = master_crc;
+		master_pecPending = 0;
 	}
 
 	/* If transaction finished, send ACK/STOP condition if instructed and set RESULT OK. */
@@ -464,11 +1087,44 @@ void TWI_MasterWriteHandler()
  */
 void TWI_MasterReadHandler()
 {
+	/* SMBus quick command, the address ACK is all there is */
+	if (master_quickRead) {
+		TWI0.MCTRLB = TWI_MCMD_STOP_gc;
+		TWI_MasterTransactionFinished(TWIM_RESULT_OK);
+		return;
+	}
+
+	/* SMBus block read, first byte is the count */
+	if (master_lengthPending) {
+		uint8_t count = TWI0.MDATA;
+		master_lengthPending = 0;
+		if (master_pecPending) {
+			master_crc = TWI_Crc8(master_crc, count);
+		}
+
+		/* More than fits in the buffer */
+		if (count > master_bytesToRead) {
+			TWI0.MCTRLB = TWI_ACKACT_bm | TWI_MCMD_STOP_gc;
+			TWI_MasterTransactionFinished(TWIM_RESULT_BUFFER_OVERFLOW);
+			return;
+		}
+		master_bytesToRead = count;
+	}
+
 	/* Fetch data if bytes to be read. */
-	if (master_bytesRead < master_bytesToRead) {
+	else if (master_bytesRead < master_bytesToRead) {
 		uint8_t data = TWI0.MDATA;
 		master_readData[master_bytesRead] = data;
 		master_bytesRead++;
+		if (master_pecPending) {
+			master_crc = TWI_Crc8(master_crc, data);
+		}
+	}
+
+	/* PEC byte, the CRC including it is zero if the data is intact */
+	else if (master_pecPending) {
+		master_crc = TWI_Crc8(master_crc, TWI0.MDATA);
+		master_pecPending = 0;
 	}
 
 	/* If buffer overflow, issue NACK/STOP and BUFFER_OVERFLOW condition. */
@@ -485,10 +1141,10 @@ void TWI_MasterReadHandler()
 	}
 
 	/* Local variable used in if test to avoid compiler warning. */
-	uint8_t bytesToRead = master_bytesToRead;
+	uint16_t bytesToRead = master_bytesToRead;
 
 	/* If more bytes to read, issue ACK and start a byte read. */
-	if (master_bytesRead < bytesToRead) {
+	if ((master_bytesRead < bytesToRead) || master_pecPending) {
 		TWI0.MCTRLB = TWI_MCMD_RECVTRANS_gc;
 	}
 
@@ -500,7 +1156,7 @@ void TWI_MasterReadHandler()
 			TWI0.MCTRLB = TWI_ACKACT_bm | TWI_MCMD_REPSTART_gc;
 		}
 		
-		TWI_MasterTransactionFinished(TWIM_RESULT_OK);
+		TWI_MasterTransactionFinished((master_pec && master_crc) ? TWIM_RESULT_PEC_ERROR : TWIM_RESULT_OK);
 	}
 }
 
@@ -513,9 +1169,14 @@ void TWI_MasterReadHandler()
  */
 void TWI_MasterTransactionFinished(uint8_t result)
 {
+	scan_active = 0;
+	if (master_quickRead) {
+		TWI0.MCTRLA &= ~TWI_QCEN_bm;
+		master_quickRead = 0;
+	}
 	master_result = result;
 	master_trans_status = TWIM_STATUS_READY;
-	twi_mode = TWI_MODE_MASTER;
+	master_mode = TWI_MODE_MASTER;
 }
 
 
@@ -600,21 +1261,30 @@ void TWI_SlaveAddressMatchHandler(){
 	slave_trans_status = TWIS_STATUS_BUSY;
 	slave_result = TWIS_RESULT_UNKNOWN;
 	
+	/* SDATA holds the received address, needed with a second address or mask */
+	slave_matchedAddress = TWI0.SDATA >> 1;
+	
 	/* Send ACK, wait for data interrupt */
 	TWI0.SCTRLB = TWI_SCMD_RESPONSE_gc;	
 	
 	/* If Master Read/Slave Write */
 	if(TWI0.SSTATUS & TWI_DIR_bm){
 		slave_bytesWritten = 0;
-		/* Call user function  */
-		slave_bytesToWrite = TWI_onSlaveTransmit();	
-		twi_mode = TWI_MODE_SLAVE_TRANSMIT;
+		/* Call user function, unless registers are served directly */
+		if(!slave_regFile){
+			slave_bytesToWrite = TWI_onSlaveTransmit();	
+		}
+		slave_mode = TWI_MODE_SLAVE_TRANSMIT;
 	} 
 	/* If Master Write/Slave Read */
 	else {
 		slave_bytesRead = 0;
-		slave_callUserReceive = 1;
-		twi_mode = TWI_MODE_SLAVE_RECEIVE;
+		if(slave_regFile){
+			slave_regPointerPending = 1;
+		} else {
+			slave_callUserReceive = 1;
+		}
+		slave_mode = TWI_MODE_SLAVE_RECEIVE;
 	}
 	
 	/* Data interrupt to follow... */
@@ -643,8 +1313,17 @@ void TWI_SlaveDataHandler(){
 	/* Enable stop interrupt */
 	TWI0.SCTRLA |= (TWI_APIEN_bm | TWI_PIEN_bm);	
 	
+	/* Register file, no user buffers involved */
+	if(slave_regFile){
+		if(TWI0.SSTATUS & TWI_DIR_bm){
+			TWI_SlaveRegisterWriteHandler();
+		} else {
+			TWI_SlaveRegisterReadHandler();
+		}
+	}
+
 	/* If Master Read/Slave Write */
-	if(TWI0.SSTATUS & TWI_DIR_bm){
+	else if(TWI0.SSTATUS & TWI_DIR_bm){
 		
 		TWI_SlaveWriteHandler();
 	}
@@ -721,6 +1400,97 @@ void TWI_SlaveReadHandler(){
 	}	
 }
 
+/*! \brief TWI slave register file write interrupt handler.
+ *
+ *  Sends the register at the register pointer to the master and advances
+ *  the pointer. Reads past the last register return 0xFF.
+ *
+ */
+void TWI_SlaveRegisterWriteHandler(){
+	
+	/* If NACK, slave write transaction finished */
+	if((slave_bytesWritten > 0) && (TWI0.SSTATUS & TWI_RXACK_bm)){
+
+		TWI0.SCTRLB = TWI_SCMD_COMPTRANS_gc;
+		TWI_SlaveTransactionFinished(TWIS_RESULT_OK);
+	}
+	
+	/* If ACK, master expects more data */
+	else {
+		uint16_t reg = slave_regPointer;
+		uint8_t data = 0xFF;
+
+		if(reg < slave_regSize){
+			data = slave_regFile[reg];
+			slave_regPointer = reg + 1;
+		}
+		TWI0.SDATA = data;
+		slave_bytesWritten = 1;
+
+		/* Send data, wait for data interrupt */
+		TWI0.SCTRLB = TWI_SCMD_RESPONSE_gc;
+	}
+}
+
+/*! \brief TWI slave register file read interrupt handler.
+ *
+ *  The first byte of a master write sets the register pointer, following
+ *  bytes are stored in consecutive registers. Writes to read only registers
+ *  are acknowledged and dropped, writes past the last register are NACKed.
+ *
+ */
+void TWI_SlaveRegisterReadHandler(){
+	uint8_t data = TWI0.SDATA;
+	uint16_t reg = slave_regPointer;
+
+	if(slave_regPointerPending){
+		slave_regPointer = data;
+		slave_regPointerPending = 0;
+	}
+	else if(reg < slave_regSize){
+		if(!slave_regReadOnly || !(slave_regReadOnly[reg >> 3] & (1 << (reg & 7)))){
+			slave_regFile[reg] = data;
+		}
+		slave_regPointer = reg + 1;
+	}
+	else {
+		TWI0.SCTRLB = TWI_ACKACT_bm | TWI_SCMD_COMPTRANS_gc;
+		TWI_SlaveTransactionFinished(TWIS_RESULT_BUFFER_OVERFLOW);
+		return;
+	}
+
+	/* Send ACK and wait for data interrupt */
+	TWI0.SCTRLB = TWI_SCMD_RESPONSE_gc;
+}
+
+/*! \brief Serve a memory region as slave registers.
+ *
+ *  Master writes and reads go directly to/from the region through an
+ *  auto-incrementing register pointer set by the first byte of a write,
+ *  without calling the onReceive/onRequest callbacks. Multi-byte values
+ *  should be updated with interrupts disabled to be seen consistently.
+ *
+ *  \param registers		Register memory, NULL to return to callback mode.
+ *  \param size			Number of registers, up to 256.
+ *  \param read_only		Bit mask with one bit per register (LSB first) set
+ *						for registers the master cannot write, or NULL.
+ */
+void TWI_SlaveSetRegisterFile(uint8_t* registers, uint16_t size, const uint8_t* read_only)
+{
+	uint8_t sctrla = TWI0.SCTRLA;
+
+	/* Keep the slave ISR out while switching */
+	TWI0.SCTRLA = sctrla & ~(TWI_DIEN_bm | TWI_APIEN_bm | TWI_PIEN_bm);
+
+	slave_regFile = registers;
+	slave_regSize = (size > 256) ? 256 : size;
+	slave_regReadOnly = read_only;
+	slave_regPointer = 0;
+	slave_regPointerPending = 0;
+
+	TWI0.SCTRLA = sctrla;
+}
+
 /* 
  * Function twi_attachSlaveRxEvent
  * Desc     sets function called before a slave read operation
@@ -754,7 +1524,7 @@ void TWI_attachSlaveTxEvent( uint8_t (*function)(void), uint8_t* write_data ){
 void TWI_SlaveTransactionFinished(uint8_t result)
 {
 	TWI0.SCTRLA |= (TWI_APIEN_bm | TWI_PIEN_bm);
-	twi_mode = TWI_MODE_SLAVE;
+	slave_mode = TWI_MODE_SLAVE;
 	slave_result = result;
 	slave_trans_status = TWIM_STATUS_READY;
 }
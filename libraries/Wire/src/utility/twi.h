@@ -23,6 +23,7 @@
 #define TWI_DRIVER_H
 
 #include "avr/io.h"
+#include "twi_trace.h"
 
 /*! Transaction status defines. */
 #define TWIM_STATUS_READY              0
@@ -41,8 +42,42 @@ typedef enum TWIM_RESULT_enum {
 	TWIM_RESULT_BUS_ERROR        = (0x04<<0),
 	TWIM_RESULT_NACK_RECEIVED    = (0x05<<0),
 	TWIM_RESULT_FAIL             = (0x06<<0),
+	TWIM_RESULT_ADDRESS_NACK     = (0x07<<0),
+	TWIM_RESULT_TIMEOUT          = (0x08<<0),
+	TWIM_RESULT_BUS_STUCK        = (0x09<<0),
+	TWIM_RESULT_PEC_ERROR        = (0x0A<<0),
 } TWIM_RESULT_t;
 
+/*! Master error codes, as returned by endTransmission() in the Wire library. */
+typedef enum TWIM_ERROR_enum {
+	TWIM_ERROR_NONE              = 0,
+	TWIM_ERROR_DATA_TOO_LONG     = 1,
+	TWIM_ERROR_ADDRESS_NACK      = 2,
+	TWIM_ERROR_DATA_NACK         = 3,
+	TWIM_ERROR_OTHER             = 4,
+	TWIM_ERROR_TIMEOUT           = 5,
+	TWIM_ERROR_BUS_STUCK         = 6,
+	TWIM_ERROR_ARBITRATION_LOST  = 7,
+	TWIM_ERROR_PEC               = 8,
+} TWIM_ERROR_t;
+
+/*! Default software timeout of a master transaction, in microseconds. */
+#ifndef TWI_MASTER_DEFAULT_TIMEOUT
+#define TWI_MASTER_DEFAULT_TIMEOUT     25000
+#endif
+
+/*! SMBus transaction timeout (T_TIMEOUT max), in microseconds. */
+#define TWI_SMBUS_TIMEOUT              35000
+
+/*! SMBus transaction options. */
+#define TWI_SMBUS_BLOCK                0x01
+#define TWI_SMBUS_QUICK_READ           0x02
+
+/*! Number of times a transaction is restarted after losing arbitration. */
+#ifndef TWI_MASTER_ARBITRATION_RETRIES
+#define TWI_MASTER_ARBITRATION_RETRIES 3
+#endif
+
 /* Transaction result enumeration */
 typedef enum TWIS_RESULT_enum {
 	TWIS_RESULT_UNKNOWN            = (0x00<<0),
@@ -71,24 +106,46 @@ typedef enum TWI_MODE_enum {
 
 void TWI_MasterInit(uint32_t frequency);
 void TWI_SlaveInit(uint8_t address);
+uint8_t TWI_DualModeEnabled(void);
+void TWI_SlaveSetSecondAddress(uint8_t address);
+void TWI_SlaveSetAddressMask(uint8_t mask);
+uint8_t TWI_SlaveMatchedAddress(void);
 void TWI_Flush(void);
 void TWI_Disable(void);
 TWI_BUSSTATE_t TWI_MasterState(void);
 uint8_t TWI_MasterReady(void);
-void TWI_MasterSetBaud(uint32_t frequency);
+uint32_t TWI_MasterSetBaud(uint32_t frequency);
+void TWI_MasterSetRiseTime(uint16_t t_rise_ns);
+uint32_t TWI_MasterFrequency(void);
+void TWI_MasterSetTimeout(uint32_t timeout_us, uint8_t recover_bus);
+uint8_t TWI_MasterTimeoutFlag(void);
+void TWI_MasterClearTimeoutFlag(void);
+uint8_t TWI_MasterError(void);
+uint8_t TWI_MasterRecoverBus(void);
 uint8_t TWI_MasterWrite(uint8_t slave_address,
                      uint8_t *write_data,
-                     uint8_t bytes_to_write,
+                     uint16_t bytes_to_write,
 					 uint8_t send_stop);
-uint8_t TWI_MasterRead(uint8_t slave_address,
+uint16_t TWI_MasterRead(uint8_t slave_address,
                     uint8_t* read_data,
-                    uint8_t bytes_to_read,
+                    uint16_t bytes_to_read,
 					uint8_t send_stop);
-uint8_t TWI_MasterWriteRead(uint8_t slave_address,
+uint16_t TWI_MasterWriteRead(uint8_t slave_address,
                          uint8_t *write_data,
-                         uint8_t bytes_to_write,
-                         uint8_t bytes_to_read,
+                         uint16_t bytes_to_write,
+                         uint16_t bytes_to_read,
 						 uint8_t send_stop);
+uint8_t TWI_MasterBlockRead(uint8_t slave_address,
+                         uint8_t command,
+                         uint8_t *read_data,
+                         uint8_t size);
+uint8_t TWI_MasterQuickCommand(uint8_t slave_address, uint8_t read);
+void TWI_MasterSetSMBus(uint8_t enable);
+void TWI_MasterSetPEC(uint8_t enable);
+uint8_t TWI_MasterScanStart(uint8_t *found, uint8_t first, uint8_t last);
+uint8_t TWI_MasterScanBusy(void);
+void TWI_TraceStart(TWI_TRACE_t *buffer, uint8_t depth);
+uint8_t TWI_TraceRead(TWI_TRACE_t *entry);
 void TWI_MasterInterruptHandler(void);
 void TWI_MasterArbitrationLostBusErrorHandler(void);
 void TWI_MasterWriteHandler(void);
@@ -101,6 +158,9 @@ void TWI_SlaveStopHandler(void);
 void TWI_SlaveDataHandler(void);
 void TWI_SlaveWriteHandler(void);
 void TWI_SlaveReadHandler(void);
+void TWI_SlaveRegisterWriteHandler(void);
+void TWI_SlaveRegisterReadHandler(void);
+void TWI_SlaveSetRegisterFile(uint8_t* registers, uint16_t size, const uint8_t* read_only);
 void TWI_attachSlaveRxEvent( void (*function)(int), uint8_t *read_data, uint8_t bytes_to_read );
 void TWI_attachSlaveTxEvent( uint8_t (*function)(void), uint8_t *write_data );
 void TWI_SlaveTransactionFinished(uint8_t result);
@@ -0,0 +1,20 @@
+/*! Transaction trace of the TWI master, shared with the Wire library API. */
+#ifndef TWI_TRACE_H
+#define TWI_TRACE_H
+
+#include <stdint.h>
+
+/*! Transaction trace entry. */
+typedef struct TWI_TRACE_struct {
+	uint32_t timestamp;    /*!< micros() at the start of the transaction */
+	uint16_t duration;     /*!< Duration in us, saturates at 65535 */
+	uint16_t length;       /*!< Bytes written plus bytes read */
+	uint8_t  address;      /*!< 7 bit slave address */
+	uint8_t  direction;    /*!< TWI_TRACE_WRITE and/or TWI_TRACE_READ */
+	uint8_t  result;       /*!< TWIM_ERROR_t code, 0 on success */
+} TWI_TRACE_t;
+
+#define TWI_TRACE_WRITE                0x01
+#define TWI_TRACE_READ                 0x02
+
+#endif /* TWI_TRACE_H */